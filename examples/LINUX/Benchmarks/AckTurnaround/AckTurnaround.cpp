@@ -0,0 +1,91 @@
+
+/* Measures the time elapsed between the reception of the last byte of a
+   packet and the transmission of the acknowledgement, using a loopback
+   strategy that returns a single byte for each receive_frame call like
+   SoftwareBitBang, OverSampling or ThroughSerial do.
+
+   receive folds the CRC while bytes arrive, so the turnaround does not
+   depend on the packet length. The time needed to recompute the CRC of the
+   whole frame (as done before the last byte could be acknowledged) is
+   printed for comparison. */
+
+#define PJON_PACKET_MAX_LENGTH 1100
+#include <PJON.h>
+
+#define ITERATIONS 2000
+
+uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+};
+
+struct ByteLoopback {
+  static uint8_t frame[PJON_PACKET_MAX_LENGTH];
+  static uint16_t length, position;
+  static uint64_t last_byte_time, response_time;
+
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  uint8_t get_max_attempts() { return 0; };
+  uint32_t back_off(uint8_t) { return 0; };
+  void handle_collision() { };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_frame(uint8_t *, uint16_t) { };
+
+  uint16_t receive_frame(uint8_t *data, uint16_t) {
+    if(position >= length) return PJON_FAIL;
+    *data = frame[position++];
+    if(position == length) last_byte_time = nanoseconds();
+    return 1;
+  };
+
+  void send_response(uint8_t) { response_time = nanoseconds(); };
+};
+
+uint8_t  ByteLoopback::frame[PJON_PACKET_MAX_LENGTH];
+uint16_t ByteLoopback::length, ByteLoopback::position;
+uint64_t ByteLoopback::last_byte_time, ByteLoopback::response_time;
+
+PJON<ByteLoopback> transmitter(1);
+PJON<ByteLoopback> receiver(44);
+
+int main() {
+  uint8_t payload[1024];
+  for(uint16_t i = 0; i < sizeof(payload); i++) payload[i] = rand();
+  transmitter.set_crc_32(true);
+
+  printf("Payload  ACK turnaround  Full frame CRC32 (ns)\n");
+  uint16_t lengths[] = {16, 64, 256, 1024};
+  for(uint8_t l = 0; l < 4; l++) {
+    ByteLoopback::length = transmitter.compose_packet(
+      transmitter.fill_info(44, PJON_NO_HEADER, 0, PJON_BROADCAST),
+      ByteLoopback::frame,
+      payload,
+      lengths[l]
+    );
+    uint64_t turnaround = 0, crc = 0;
+    for(uint16_t i = 0; i < ITERATIONS; i++) {
+      ByteLoopback::position = 0;
+      if(receiver.receive() != PJON_ACK) {
+        printf("Reception failed\n");
+        return 1;
+      }
+      turnaround +=
+        ByteLoopback::response_time - ByteLoopback::last_byte_time;
+      uint64_t start = nanoseconds();
+      volatile uint32_t result = PJON_crc32::compute(
+        ByteLoopback::frame, ByteLoopback::length - 4
+      );
+      (void)result;
+      crc += nanoseconds() - start;
+    }
+    printf(
+      "%7d %15.0f %22.0f\n",
+      lengths[l],
+      (double)turnaround / ITERATIONS,
+      (double)crc / ITERATIONS
+    );
+  }
+  return 0;
+};
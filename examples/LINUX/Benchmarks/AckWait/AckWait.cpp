@@ -0,0 +1,94 @@
+/* Measures the retransmissions of two nodes sending packets to each other
+   as fast as possible, each in its own thread, with DualUDP and GlobalUDP.
+   A node waiting for an acknowledgement receives the packets of the other
+   node: the strategies queue them and return them with the following
+   receive_frame calls. The Makefile builds the benchmark with the default
+   queue (AckWait) and with PJON_UDP_INBOX_LENGTH 0 (AckWaitDrop), dropping
+   them as the strategies did before, so the other node retransmits them.
+
+   The retries are the transmissions not acknowledged in time, packets
+   received again because of a retransmission are detected by the packet id
+   and acknowledged. DUDP_MINIMUM_SEND_INTERVAL_MS is 0 so DualUDP does not
+   refuse transmissions started less than 8ms after the previous one. */
+
+#define PJON_INCLUDE_STATS
+#define PJON_INCLUDE_PACKET_ID
+#define PJON_MAX_PACKETS 4
+#define DUDP_MINIMUM_SEND_INTERVAL_MS 0
+#include <PJONDualUDP.h>
+#include <PJONGlobalUDP.h>
+#include <thread>
+#include <atomic>
+
+#define DURATION_MS 3000
+#define PORT_A      7400
+#define PORT_B      7401
+
+std::atomic<bool> running(false), sending(false);
+template<typename Bus>
+void node(Bus &bus, uint8_t id, PJON_Stats &stats) {
+  uint8_t payload[20] = {0};
+  while(!running) std::this_thread::yield();
+  while(sending) {
+    if(bus.get_packets_count() < PJON_MAX_PACKETS)
+      bus.send(id, payload, sizeof(payload));
+    bus.update();
+    bus.receive(1000);
+  }
+  // Deliver the packets queued and acknowledge the last ones received
+  uint32_t start = PJON_MILLIS();
+  while(((uint32_t)(PJON_MILLIS() - start) < 1000) && bus.update())
+    bus.receive(1000);
+  start = PJON_MILLIS();
+  while((uint32_t)(PJON_MILLIS() - start) < 200) bus.receive(1000);
+  stats = bus.get_stats();
+};
+
+template<typename Bus>
+void measure(const char *name) {
+  const uint8_t localhost[4] = {127, 0, 0, 1};
+  Bus a(1), b(2);
+  a.strategy.set_port(PORT_A);
+  b.strategy.set_port(PORT_B);
+  a.strategy.add_node(2, localhost, PORT_B);
+  b.strategy.add_node(1, localhost, PORT_A);
+  a.set_packet_id(true);
+  b.set_packet_id(true);
+  a.begin();
+  b.begin();
+  PJON_Stats stats[2];
+  std::thread first(node<Bus>, std::ref(a), 2, std::ref(stats[0]));
+  std::thread second(node<Bus>, std::ref(b), 1, std::ref(stats[1]));
+  sending = running = true;
+  PJON_DELAY(DURATION_MS);
+  sending = false;
+  first.join();
+  second.join();
+  running = false;
+  uint32_t delivered = 0, lost = 0, frames = 0;
+  for(uint8_t n = 0; n < 2; n++) {
+    for(uint8_t i = 0; i < PJON_STATS_ATTEMPTS; i++)
+      delivered += stats[n].attempts[i];
+    lost += stats[n].lost;
+    frames += stats[n].tx_frames;
+  }
+  uint32_t retries = frames - delivered;
+  printf(
+    "%-9s %8.0f packets/s %6u retries (%6.1f%%) %5u lost\n",
+    name,
+    delivered * 1000.0 / DURATION_MS,
+    retries,
+    delivered ? retries * 100.0 / delivered : 0.0,
+    lost
+  );
+};
+
+int main() {
+  printf(
+    "Frames received while waiting for an acknowledgement: %s\n",
+    PJON_UDP_INBOX_LENGTH ? "queued" : "dropped"
+  );
+  measure<PJONDualUDP>("DualUDP");
+  measure<PJONGlobalUDP>("GlobalUDP");
+  return 0;
+};
@@ -0,0 +1,56 @@
+
+/* Compares the CRC32 implementations selectable with PJON_CRC32_MODE:
+   results are checked byte for byte against the table-less implementation
+   then the throughput of each one is printed. */
+
+#include <PJON.h>
+
+#define BUFFER_LENGTH 1024
+#define ITERATIONS    20000
+
+uint8_t buffer[BUFFER_LENGTH];
+
+typedef uint32_t (* CRC32_Function)(const uint8_t *, uint16_t, uint32_t);
+
+bool verify(CRC32_Function f, const char *name) {
+  for(uint16_t length = 0; length <= BUFFER_LENGTH; length++)
+    for(uint8_t offset = 0; offset < 8 && offset + length <= BUFFER_LENGTH; offset++)
+      if(
+        f(buffer + offset, length, 0) !=
+        PJON_crc32::compute_bitwise(buffer + offset, length, 0)
+      ) {
+        printf("%s mismatch at length %d offset %d\n", name, length, offset);
+        return false;
+      }
+  printf("%s output matches table-less implementation\n", name);
+  return true;
+};
+
+void measure(CRC32_Function f, const char *name, uint16_t length) {
+  volatile uint32_t result = 0;
+  uint32_t start = micros();
+  for(uint32_t i = 0; i < ITERATIONS; i++) result ^= f(buffer, length, i);
+  uint32_t elapsed = micros() - start;
+  printf(
+    "%-9s %5d B: %8.1f MB/s\n",
+    name,
+    length,
+    ((double)length * ITERATIONS) / (elapsed ? elapsed : 1)
+  );
+};
+
+int main() {
+  for(uint16_t i = 0; i < BUFFER_LENGTH; i++) buffer[i] = rand();
+  if(
+    !verify(PJON_crc32::compute_table, "Table") ||
+    !verify(PJON_crc32::compute_slice_8, "Slice-8")
+  ) return 1;
+
+  uint16_t lengths[] = {16, 64, 256, 1024};
+  for(uint8_t l = 0; l < 4; l++) {
+    measure(PJON_crc32::compute_bitwise, "Bitwise", lengths[l]);
+    measure(PJON_crc32::compute_table, "Table", lengths[l]);
+    measure(PJON_crc32::compute_slice_8, "Slice-8", lengths[l]);
+  }
+  return 0;
+};
@@ -0,0 +1,62 @@
+
+/* Compares the throughput in bytes per CPU cycle of the CRC32 carry-less
+   multiplication folding (PJON_CRC32_CLMUL) with the portable slicing-by-8
+   and table-less implementations, for inputs from 16 bytes to 64KB.
+   Results are verified against the table-less implementation. */
+
+#define PJON_CRC32_MODE PJON_CRC32_CLMUL
+#include <PJON.h>
+#include <x86intrin.h>
+
+#define BUFFER_LENGTH 65535
+
+uint8_t buffer[BUFFER_LENGTH];
+
+typedef uint32_t (* CRC32_Function)(const uint8_t *, uint16_t, uint32_t);
+
+double bytes_per_cycle(CRC32_Function f, uint16_t length) {
+  uint32_t iterations = 1 + (4000000 / length);
+  volatile uint32_t result = 0;
+  uint64_t start = __rdtsc();
+  for(uint32_t i = 0; i < iterations; i++) result ^= f(buffer, length, i);
+  return ((double)length * iterations) / (__rdtsc() - start);
+};
+
+int main() {
+  for(uint32_t i = 0; i < BUFFER_LENGTH; i++) buffer[i] = rand();
+  printf(
+    "PCLMULQDQ %s\n",
+    PJON_crc32_clmul::supported() ? "supported" : "not supported"
+  );
+
+  for(uint32_t length = 0; length <= 1024; length++)
+    for(uint8_t offset = 0; offset < 16; offset++)
+      if(
+        PJON_crc32::compute_clmul(buffer + offset, length, length) !=
+        PJON_crc32::compute_bitwise(buffer + offset, length, length)
+      ) {
+        printf("Mismatch at length %d offset %d\n", length, offset);
+        return 1;
+      }
+  if(
+    PJON_crc32::compute_clmul(buffer, BUFFER_LENGTH) !=
+    PJON_crc32::compute_bitwise(buffer, BUFFER_LENGTH)
+  ) {
+    printf("Mismatch at length %d\n", BUFFER_LENGTH);
+    return 1;
+  }
+  printf("Output matches table-less implementation\n\n");
+
+  printf("  Length    Bitwise    Slice-8      CLMUL (bytes/cycle)\n");
+  for(uint32_t length = 16; length <= 65536; length *= 4) {
+    uint16_t l = (length > BUFFER_LENGTH) ? BUFFER_LENGTH : length;
+    printf(
+      "%8d %10.3f %10.3f %10.3f\n",
+      l,
+      bytes_per_cycle(PJON_crc32::compute_bitwise, l),
+      bytes_per_cycle(PJON_crc32::compute_slice_8, l),
+      bytes_per_cycle(PJON_crc32::compute_clmul, l)
+    );
+  }
+  return 0;
+};
@@ -0,0 +1,92 @@
+/* Measures the jitter of the delays on Linux: the oversleep (time elapsed
+   minus the delay requested) of the previous implementations (select and
+   std::this_thread::sleep_for), of clock_nanosleep alone (as with
+   PJON_LINUX_SLEEP_DELAY defined, and of delayMicroseconds and delay), of
+   PJON_LINUX_precise_delay (sleep and spin) and the CPU time per delay. */
+
+#include <PJON.h>
+#include <sys/select.h>
+#include <algorithm>
+
+#define SAMPLES 500
+
+uint64_t nanoseconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000000000ull + time.tv_nsec;
+};
+
+uint64_t thread_cpu_nanoseconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec * 1000000000ull + time.tv_nsec;
+};
+
+void select_delay(uint32_t duration) {
+  struct timeval tv;
+  tv.tv_sec = duration / 1000000;
+  tv.tv_usec = duration % 1000000;
+  select(0, NULL, NULL, NULL, &tv);
+};
+
+void sleep_for_delay(uint32_t duration) {
+  std::this_thread::sleep_for(std::chrono::microseconds(duration));
+};
+
+void nanosleep_delay(uint32_t duration) {
+  PJON_LINUX_sleep_until(PJON_LINUX_monotonic_ns() + (duration * 1000ull));
+};
+
+void microsecond_delay(uint32_t duration) {
+  delayMicroseconds(duration);
+};
+
+void precise_delay(uint32_t duration) {
+  PJON_LINUX_precise_delay(duration);
+};
+
+void millisecond_delay(uint32_t duration) {
+  delay(duration / 1000);
+};
+
+void measure(const char *name, void (*delay_function)(uint32_t), uint32_t duration) {
+  static double oversleep[SAMPLES];
+  uint32_t samples = (duration >= 5000) ? SAMPLES / 5 : SAMPLES;
+  uint64_t cpu = thread_cpu_nanoseconds();
+  for(uint32_t i = 0; i < samples; i++) {
+    uint64_t start = nanoseconds();
+    delay_function(duration);
+    oversleep[i] = (nanoseconds() - start) / 1000.0 - duration;
+  }
+  cpu = thread_cpu_nanoseconds() - cpu;
+  std::sort(oversleep, oversleep + samples);
+  printf(
+    "%-18s %6u %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+    name,
+    duration,
+    oversleep[0],
+    oversleep[samples / 2],
+    oversleep[(samples * 99) / 100],
+    oversleep[samples - 1],
+    cpu / 1000.0 / samples
+  );
+};
+
+int main() {
+  const uint32_t durations[] = {10, 100, 1000, 5000};
+  printf("Oversleep in microseconds, %u samples per delay\n", SAMPLES);
+  printf(
+    "%-18s %6s %8s %8s %8s %8s %8s\n",
+    "delay", "us", "min", "p50", "p99", "max", "cpu us"
+  );
+  for(uint8_t d = 0; d < 4; d++) {
+    measure("select", select_delay, durations[d]);
+    measure("sleep_for", sleep_for_delay, durations[d]);
+    measure("clock_nanosleep", nanosleep_delay, durations[d]);
+    measure("delayMicroseconds", microsecond_delay, durations[d]);
+    measure("precise_delay", precise_delay, durations[d]);
+    if(durations[d] >= 1000)
+      measure("delay", millisecond_delay, durations[d]);
+  }
+  printf("Calibrated spin margin: %u us\n", PJON_LINUX_spin_margin().load());
+};
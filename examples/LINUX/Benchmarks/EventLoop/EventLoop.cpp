@@ -0,0 +1,140 @@
+
+/* Compares a receiver thread polling receive of one or two GlobalUDP
+   instances (as the examples do) with PJONEventLoop, on localhost. The
+   packets are received by the first instance, the second is idle. Note
+   that the UDP socket's receive timeout is 1ms:
+   - CPU time used by the receiver thread while no packet is received;
+   - wake-to-receive latency, from the transmission of a timestamped packet
+     to the call of the receiver function, and the CPU time used meanwhile
+     (a packet every INTERVAL_US). */
+
+#include <PJONGlobalUDP.h>
+#include <PJONEventLoop.h>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#define SAMPLES     1000
+#define INTERVAL_US 2000
+#define TX_PORT     7300
+#define RX_PORT     7301
+#define IDLE_PORT   7302
+
+uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+};
+
+uint64_t thread_cpu_nanoseconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec * 1000000000ull + time.tv_nsec;
+};
+
+const uint8_t localhost[4] = {127, 0, 0, 1};
+std::atomic<bool> running(false);
+bool two_buses = false;
+std::atomic<uint32_t> received(0);
+std::atomic<uint64_t> cpu_time(0);
+uint64_t latency[SAMPLES];
+
+void receiver_function(uint8_t *payload, uint16_t, const PJON_Packet_Info &) {
+  uint64_t sent;
+  memcpy(&sent, payload, sizeof(sent));
+  uint32_t i = received.load();
+  if(i < SAMPLES) latency[i] = nanoseconds() - sent;
+  received.store(i + 1);
+};
+
+void polling(PJON<GlobalUDP> &bus, PJON<GlobalUDP> &idle) {
+  uint64_t start = thread_cpu_nanoseconds();
+  while(running) {
+    bus.update();
+    bus.receive();
+    if(!two_buses) continue;
+    idle.update();
+    idle.receive();
+  }
+  cpu_time = thread_cpu_nanoseconds() - start;
+};
+
+void event_loop(PJON<GlobalUDP> &bus, PJON<GlobalUDP> &idle) {
+  PJONEventLoop loop;
+  loop.add(bus);
+  if(two_buses) loop.add(idle);
+  uint64_t start = thread_cpu_nanoseconds();
+  while(running) loop.run_once(50);
+  cpu_time = thread_cpu_nanoseconds() - start;
+};
+
+/* Runs the receiver in a thread for the duration of phase, returns the
+   receiver's CPU usage in percent: */
+
+typedef void (*Receiver)(PJON<GlobalUDP> &, PJON<GlobalUDP> &);
+
+template<typename Phase>
+double measure(
+  Receiver receiver,
+  PJON<GlobalUDP> &bus,
+  PJON<GlobalUDP> &idle,
+  Phase phase
+) {
+  running = true;
+  uint64_t start = nanoseconds();
+  std::thread thread(receiver, std::ref(bus), std::ref(idle));
+  phase();
+  running = false;
+  thread.join();
+  return cpu_time * 100.0 / (nanoseconds() - start);
+};
+
+void compare(const char *name, Receiver receiver, bool two) {
+  two_buses = two;
+  PJON<GlobalUDP> rx(44), tx(45), idle(46);
+  rx.strategy.set_port(RX_PORT);
+  idle.strategy.set_port(IDLE_PORT);
+  tx.strategy.set_port(TX_PORT);
+  tx.strategy.add_node(44, localhost, RX_PORT);
+  rx.set_receiver(receiver_function);
+  tx.set_acknowledge(false);
+  rx.begin();
+  tx.begin();
+  idle.begin();
+  double idle_cpu = measure(receiver, rx, idle, []() {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  });
+  received = 0;
+  double busy_cpu = measure(receiver, rx, idle, [&]() {
+    uint8_t payload[16] = {0};
+    for(uint32_t i = 0; i < SAMPLES; i++) {
+      uint64_t now = nanoseconds();
+      memcpy(payload, &now, sizeof(now));
+      tx.send_packet(44, payload, sizeof(payload));
+      std::this_thread::sleep_for(std::chrono::microseconds(INTERVAL_US));
+    }
+  });
+  uint32_t count = std::min((uint32_t)received, (uint32_t)SAMPLES);
+  std::sort(latency, latency + count);
+  printf(
+    "%-10s  %u bus%s  idle CPU %5.1f%%  CPU %5.1f%%  latency p50 %6.1f us  "
+    "p99 %7.1f us  (%u/%u received)\n",
+    name,
+    two ? 2 : 1,
+    two ? "es" : "  ",
+    idle_cpu,
+    busy_cpu,
+    count ? latency[count / 2] / 1000.0 : 0,
+    count ? latency[count * 99 / 100] / 1000.0 : 0,
+    count,
+    SAMPLES
+  );
+};
+
+int main() {
+  for(uint8_t two = 0; two < 2; two++) {
+    compare("Polling", polling, two);
+    compare("EventLoop", event_loop, two);
+  }
+  return 0;
+};
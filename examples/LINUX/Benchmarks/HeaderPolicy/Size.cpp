@@ -0,0 +1,26 @@
+
+/* Compose and parse functions compiled with the dynamic header policy or,
+   defining STATIC_HEADER, with PJON_Static_Header, used by make size to
+   compare the code size of the two policies. */
+
+#include <PJON.h>
+
+#ifdef STATIC_HEADER
+  typedef PJON_Static_Header<PJON_MODE_BIT | PJON_TX_INFO_BIT | PJON_CRC_BIT>
+    Header;
+#else
+  typedef PJON_Dynamic_Header Header;
+#endif
+
+uint16_t compose(
+  const PJON_Packet_Info &info,
+  uint8_t *destination,
+  const void *source,
+  uint16_t length
+) {
+  return Header::compose_packet(info, destination, source, length);
+};
+
+void parse(const uint8_t *packet, PJON_Packet_Info &info) {
+  Header::parse_header(packet, info);
+};
@@ -0,0 +1,61 @@
+
+/* Reports the RAM needed to buffer PJON_MAX_PACKETS packets using the
+   packet arena (PJON_INCLUDE_PACKET_ARENA) compared to the static buffer,
+   which reserves PJON_PACKET_MAX_LENGTH bytes for each packet, for a few
+   representative traffic mixes. */
+
+#define PJON_MAX_PACKETS 100
+#define PJON_PACKET_MAX_LENGTH 1100
+#define PJON_PACKET_ARENA_LENGTH 65536
+#define PJON_INCLUDE_PACKET_ARENA
+#include <PJON.h>
+
+struct Idle {
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  uint8_t get_max_attempts() { return 10; };
+  uint32_t back_off(uint8_t attempts) { return attempts * 1000; };
+  void handle_collision() { };
+  uint16_t receive_frame(uint8_t *, uint16_t) { return PJON_FAIL; };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_response(uint8_t) { };
+  void send_frame(uint8_t *, uint16_t) { };
+};
+
+struct Mix {
+  const char *name;
+  uint8_t small, medium; // Percentage of 10 and 100 bytes packets
+};                       // the rest are 1KB configuration blobs
+
+uint8_t payload[1024];
+
+int main() {
+  Mix mixes[] = {
+    {"Sensor readings only", 100, 0},
+    {"95% sensor, 5% 1KB", 95, 0},
+    {"70% sensor, 25% 100B, 5% 1KB", 70, 25},
+    {"50% sensor, 50% 1KB", 50, 0}
+  };
+  uint32_t fixed = (uint32_t)PJON_MAX_PACKETS * PJON_PACKET_MAX_LENGTH;
+  printf("Static buffer: %u bytes\n\n", fixed);
+  printf("%-32s %12s %8s\n", "Traffic mix", "Arena bytes", "Saving");
+  for(uint8_t m = 0; m < 4; m++) {
+    PJON<Idle> *bus = new PJON<Idle>(1);
+    srand(m);
+    for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
+      uint8_t r = rand() % 100;
+      uint16_t length =
+        (r < mixes[m].small) ? 10 :
+        (r < mixes[m].small + mixes[m].medium) ? 100 : 1024;
+      bus->send(2, payload, length);
+    }
+    printf(
+      "%-32s %12u %7.1f%%\n",
+      mixes[m].name,
+      bus->arena.used,
+      100.0 - ((100.0 * bus->arena.used) / fixed)
+    );
+    delete bus;
+  }
+  return 0;
+};
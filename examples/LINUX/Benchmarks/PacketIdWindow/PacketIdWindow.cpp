@@ -0,0 +1,60 @@
+
+/* Measures the cost of the duplicate packet detection (known_packet_id)
+   for the window configured with PJON_MAX_RECENT_PACKET_IDS, simulating a
+   router receiving packets from 500 senders of different buses.
+
+   The Makefile builds the benchmark for windows of 10, 100 and 1000 packet
+   ids, with the linear buffer and defining PJON_INCLUDE_PACKET_ID_HASH. */
+
+#include <PJON.h>
+
+#define ITERATIONS 200000
+#define SENDERS    500
+
+struct Idle {
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  uint8_t get_max_attempts() { return 10; };
+  uint32_t back_off(uint8_t attempts) { return attempts * 1000; };
+  void handle_collision() { };
+  uint16_t receive_frame(uint8_t *, uint16_t) { return PJON_FAIL; };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_response(uint8_t) { };
+  void send_frame(uint8_t *, uint16_t) { };
+};
+
+PJON<Idle> bus(1);
+PJON_Packet_Info packets[SENDERS];
+uint16_t sequence[ITERATIONS];
+
+int main() {
+  for(uint16_t s = 0; s < SENDERS; s++) {
+    packets[s].header = PJON_MODE_BIT | PJON_PACKET_ID_BIT;
+    packets[s].tx.id = 1 + (s % 250);
+    packets[s].tx.bus_id[3] = s / 250;
+    packets[s].id = rand();
+  }
+  for(uint32_t i = 0; i < ITERATIONS; i++) {
+    sequence[i] = rand() % SENDERS;
+    // One packet out of 8 is a retransmission
+    if(!(rand() % 8)) sequence[i] |= 0x8000;
+  }
+  uint32_t duplicates = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(uint32_t i = 0; i < ITERATIONS; i++) {
+    PJON_Packet_Info &info = packets[sequence[i] & 0x7FFF];
+    if(!(sequence[i] & 0x8000)) info.id++;
+    duplicates += bus.known_packet_id(info);
+  }
+  double elapsed = std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - start
+  ).count();
+  printf(
+    "%-6s window %5d: %8.1f ns per packet, %u duplicates detected\n",
+    PJON_INCLUDE_PACKET_ID_HASH ? "Hash" : "Linear",
+    PJON_MAX_RECENT_PACKET_IDS,
+    elapsed / ITERATIONS,
+    duplicates
+  );
+  return 0;
+};
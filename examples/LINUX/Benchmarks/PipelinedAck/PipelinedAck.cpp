@@ -0,0 +1,185 @@
+
+/* Measures the throughput of a GlobalUDP link with latency, with the
+   synchronous acknowledgement (PipelinedAck) or with the pipelined
+   acknowledgement (PipelinedAckWindow).
+
+   A relay thread forwards the frames between the transmitter and the
+   receiver delaying them of DELAY_MS and optionally dropping a percentage
+   of the packets (not the acknowledgements), so retransmissions can be
+   counted: with pipelined acknowledgement only the lost packets are
+   transmitted again.
+
+   Usage: ./PipelinedAckWindow [window] [loss percentage] */
+
+#define PJON_MAX_PACKETS 64
+#define PJON_MAX_RECENT_PACKET_IDS 256
+#define PJON_PACKET_MAX_LENGTH 64
+#include <PJONGlobalUDP.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <poll.h>
+
+#define PACKETS       1000
+#define DELAY_MS         5
+#define TX_PORT       7200
+#define RX_PORT       7201
+#define RELAY_TX_PORT 7210 // Faces the transmitter
+#define RELAY_RX_PORT 7211 // Faces the receiver
+
+std::atomic<bool> running(true);
+std::atomic<uint32_t> frames_sent(0);
+uint32_t received = 0, duplicates = 0;
+bool delivered[PACKETS];
+uint8_t loss = 0;
+
+uint64_t milliseconds() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+};
+
+int relay_socket(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (sockaddr *)&address, sizeof(address));
+  return fd;
+};
+
+struct Delayed {
+  uint64_t time;
+  int fd;
+  uint16_t port;
+  std::vector<uint8_t> frame;
+};
+
+void relay() {
+  int fds[2] = {relay_socket(RELAY_TX_PORT), relay_socket(RELAY_RX_PORT)};
+  uint16_t destination[2] = {RX_PORT, TX_PORT};
+  std::vector<Delayed> queue;
+  uint8_t buffer[1500];
+  while(running) {
+    pollfd p[2] = {{fds[0], POLLIN, 0}, {fds[1], POLLIN, 0}};
+    poll(p, 2, 1);
+    for(uint8_t s = 0; s < 2; s++) {
+      if(!(p[s].revents & POLLIN)) continue;
+      ssize_t length = recv(fds[s], buffer, sizeof(buffer), 0);
+      if(length <= 0) continue;
+      if(s == 0) { // From the transmitter, packets can be lost
+        frames_sent++;
+        if((uint8_t)(rand() % 100) < loss) continue;
+      }
+      Delayed d;
+      d.time = milliseconds() + DELAY_MS;
+      d.fd = fds[1 - s];
+      d.port = destination[s];
+      d.frame.assign(buffer, buffer + length);
+      queue.push_back(d);
+    }
+    uint64_t now = milliseconds();
+    while(queue.size() && queue.front().time <= now) {
+      sockaddr_in address;
+      memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_port = htons(queue.front().port);
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      sendto(
+        queue.front().fd,
+        queue.front().frame.data(),
+        queue.front().frame.size(),
+        0,
+        (sockaddr *)&address,
+        sizeof(address)
+      );
+      queue.erase(queue.begin());
+    }
+  }
+  close(fds[0]);
+  close(fds[1]);
+};
+
+void receiver_function(uint8_t *payload, uint16_t, const PJON_Packet_Info &) {
+  uint16_t sequence = (payload[0] << 8) | payload[1];
+  if(delivered[sequence]) duplicates++;
+  else received++;
+  delivered[sequence] = true;
+};
+
+void receive() {
+  PJONGlobalUDP bus(2);
+  const uint8_t localhost[4] = {127, 0, 0, 1};
+  bus.strategy.set_port(RX_PORT);
+  bus.strategy.add_node(1, localhost, RELAY_RX_PORT);
+  bus.set_receiver(receiver_function);
+  bus.begin();
+  while(running) bus.receive(1000);
+};
+
+int main(int argc, char **argv) {
+  PJONGlobalUDP bus(1);
+  const uint8_t localhost[4] = {127, 0, 0, 1};
+  if(argc > 2) loss = atoi(argv[2]);
+  bus.strategy.set_port(TX_PORT);
+  bus.strategy.add_node(2, localhost, RELAY_TX_PORT);
+  bus.set_packet_id(true);
+  #if(PJON_INCLUDE_PIPELINED_ACK)
+    uint8_t window = (argc > 1) ? atoi(argv[1]) : PJON_ACK_WINDOW;
+    bus.set_ack_window(window);
+    printf("Pipelined acknowledgement, window %d", window);
+  #else
+    printf("Synchronous acknowledgement");
+  #endif
+  printf(", latency %dms, loss %d%%\n", 2 * DELAY_MS, loss);
+  bus.begin();
+
+  std::thread relay_thread(relay);
+  std::thread receiver_thread(receive);
+  PJON_DELAY(100);
+
+  uint64_t start = milliseconds();
+  uint16_t dispatched = 0;
+  uint8_t payload[20] = {0};
+  while(dispatched < PACKETS || bus.update()) {
+    while(
+      dispatched < PACKETS &&
+      bus.get_packets_count() < PJON_MAX_PACKETS
+    ) {
+      payload[0] = dispatched >> 8;
+      payload[1] = dispatched;
+      if(bus.send(2, payload, sizeof(payload)) == PJON_FAIL) break;
+      dispatched++;
+    }
+    bus.update();
+    bus.receive(100);
+  }
+  uint64_t elapsed = milliseconds() - start;
+  PJON_DELAY(100);
+  running = false;
+  relay_thread.join();
+  receiver_thread.join();
+
+  printf(
+    "%d packets in %llums: %.0f packets/s\n",
+    PACKETS,
+    (unsigned long long)elapsed,
+    PACKETS * 1000.0 / elapsed
+  );
+  printf(
+    "Delivered %u, duplicates %u, frames transmitted %u\n",
+    received,
+    duplicates,
+    (uint32_t)frames_sent
+  );
+  const PJON_Node *node = bus.strategy.get_node(2);
+  printf(
+    "Round-trip time %uus (variation %uus), response timeout %uus\n",
+    node->srtt,
+    node->rttvar,
+    bus.strategy.response_timeout(2)
+  );
+  return 0;
+};
@@ -0,0 +1,123 @@
+
+/* Measures the latency of high priority packets with a saturated packet
+   buffer, using a virtual clock and a strategy simulating a bus where each
+   frame takes FRAME_TIME to be transmitted. Device 2 acknowledges, device 3
+   is not reachable so its packets are retried until PJON_CONNECTION_LOST.
+
+   Bulk packets are dispatched to both devices keeping the buffer full,
+   a control packet is dispatched to device 2 every CONTROL_INTERVAL.
+   The latency is the time elapsed between the generation of the control
+   packet and its acknowledgement.
+
+   PriorityLatency uses the default update, PriorityLatencyClasses is built
+   with PJON_INCLUDE_PRIORITY and dispatches control packets with class 0 and
+   bulk packets with class 2. The results are deterministic. */
+
+#define PJON_MAX_PACKETS 16
+#define PJON_MICROS virtual_micros
+#define PJON_MILLIS virtual_millis
+
+#include <stdint.h>
+
+uint32_t now = 0;
+uint32_t virtual_micros() { return now; };
+uint32_t virtual_millis() { return now / 1000; };
+
+#include <PJON.h>
+#include <algorithm>
+#include <vector>
+
+#define FRAME_TIME          500 // Transmission of a frame
+#define ACK_TIME            100 // Transmission of the acknowledgement
+#define RESPONSE_TIMEOUT  10000 // Unreachable device
+#define LOOP_TIME            50 // Rest of the loop
+#define CONTROL_INTERVAL  10000
+#define DURATION       60000000 // One minute
+#define BULK_PACKETS         12 // Bulk packets kept in the buffer
+
+std::vector<uint32_t> dispatch_time(DURATION / CONTROL_INTERVAL + 1, 0);
+std::vector<uint32_t> latency;
+uint32_t bulk_delivered = 0;
+
+struct SimulatedBus {
+  uint8_t frame[PJON_PACKET_MAX_LENGTH];
+
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  static uint8_t get_max_attempts() { return 5; };
+  static uint16_t get_receive_time() { return 0; };
+  uint32_t back_off(uint8_t attempts) { return 2000ul * attempts; };
+  void handle_collision() { };
+  uint16_t receive_frame(uint8_t *, uint16_t) { return PJON_FAIL; };
+  void send_response(uint8_t) { };
+
+  void send_frame(uint8_t *data, uint16_t length) {
+    memcpy(frame, data, length);
+    now += FRAME_TIME;
+  };
+
+  uint16_t receive_response() {
+    if(frame[0] == 3) {
+      now += RESPONSE_TIMEOUT;
+      return PJON_FAIL;
+    }
+    now += ACK_TIME;
+    const uint8_t *payload =
+      frame + PJONTools::packet_overhead(frame[1]) -
+      PJONTools::crc_overhead(frame[1]);
+    if(payload[0] == 'C')
+      latency.push_back(now - dispatch_time[(payload[1] << 8) | payload[2]]);
+    else bulk_delivered++;
+    return PJON_ACK;
+  };
+};
+
+PJON<SimulatedBus> bus(1);
+
+uint16_t send(uint8_t id, const uint8_t *payload, uint8_t priority) {
+  PJON_Packet_Info info = bus.fill_info(id, PJON_NO_HEADER, 0, 0);
+  #if(PJON_INCLUDE_PRIORITY)
+    info.priority = priority;
+  #else
+    (void)priority;
+  #endif
+  return bus.send(info, payload, 20);
+};
+
+int main() {
+  uint8_t control[20] = {'C'}, bulk[20] = {'B'};
+  uint16_t controls = 0, bulk_count = 0, dropped = 0;
+  uint32_t next_control = 0;
+  bus.begin();
+  while(now < DURATION) {
+    while(bus.get_packets_count() < BULK_PACKETS)
+      if(send((bulk_count++ & 1) ? 3 : 2, bulk, 2) == PJON_FAIL) break;
+    // Control packets are generated on time even if update took longer
+    while(now >= next_control) {
+      control[1] = controls >> 8;
+      control[2] = controls;
+      dispatch_time[controls++] = next_control;
+      if(send(2, control, 0) == PJON_FAIL) dropped++;
+      next_control += CONTROL_INTERVAL;
+    }
+    bus.update();
+    now += LOOP_TIME;
+  }
+  std::sort(latency.begin(), latency.end());
+  printf(
+    "%s: control packets %u/%u (%u buffer full)\n",
+    PJON_INCLUDE_PRIORITY ? "Priority classes" : "Slot order",
+    (unsigned)latency.size(),
+    controls,
+    dropped
+  );
+  printf(
+    "Latency (ms) p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+    latency[latency.size() / 2] / 1000.0,
+    latency[latency.size() * 9 / 10] / 1000.0,
+    latency[latency.size() * 99 / 100] / 1000.0,
+    latency.back() / 1000.0
+  );
+  printf("Bulk packets delivered %u\n", bulk_delivered);
+  return 0;
+};
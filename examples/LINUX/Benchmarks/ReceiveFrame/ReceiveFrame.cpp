@@ -0,0 +1,93 @@
+
+/* Measures the packets per second received using a loopback strategy.
+   If receive_frame returns the whole frame (UDP, TCP, LocalFile) receive
+   validates it at once, if the frame is returned in more batches (here the
+   first byte and then the rest) the incremental loop is used. */
+
+#define PJON_PACKET_MAX_LENGTH 1100
+#include <PJON.h>
+
+#define ITERATIONS 200000
+
+uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+};
+
+struct FrameLoopback {
+  static uint8_t frame[PJON_PACKET_MAX_LENGTH];
+  static uint16_t length, position;
+  static bool split;
+
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  uint8_t get_max_attempts() { return 0; };
+  uint32_t back_off(uint8_t) { return 0; };
+  void handle_collision() { };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_frame(uint8_t *, uint16_t) { };
+  void send_response(uint8_t) { };
+
+  uint16_t receive_frame(uint8_t *data, uint16_t max_length) {
+    if(position >= length) return PJON_FAIL;
+    uint16_t batch = (split && !position) ? 1 : length - position;
+    if(batch > max_length) batch = max_length;
+    memcpy(data, frame + position, batch);
+    position += batch;
+    return batch;
+  };
+};
+
+uint8_t  FrameLoopback::frame[PJON_PACKET_MAX_LENGTH];
+uint16_t FrameLoopback::length, FrameLoopback::position;
+bool     FrameLoopback::split;
+
+uint32_t received = 0;
+
+void receiver_function(uint8_t *, uint16_t, const PJON_Packet_Info &) {
+  received++;
+};
+
+PJON<FrameLoopback> transmitter(1);
+PJON<FrameLoopback> receiver(44);
+
+double packets_per_second(bool split) {
+  FrameLoopback::split = split;
+  uint64_t start = nanoseconds();
+  for(uint32_t i = 0; i < ITERATIONS; i++) {
+    FrameLoopback::position = 0;
+    receiver.receive();
+  }
+  return ITERATIONS * 1e9 / (nanoseconds() - start);
+};
+
+int main() {
+  uint8_t payload[1024];
+  for(uint16_t i = 0; i < sizeof(payload); i++) payload[i] = rand();
+  receiver.set_receiver(receiver_function);
+  printf("Payload  CRC    Incremental loop  Whole frame (packets/s)\n");
+  uint16_t lengths[] = {8, 64, 256, 1024};
+  for(uint8_t crc_32 = 0; crc_32 < 2; crc_32++)
+    for(uint8_t l = 0; l < 4; l++) {
+      if(!crc_32 && lengths[l] > 200) continue; // CRC8 up to 255 bytes
+      transmitter.set_crc_32(crc_32);
+      PJON_Packet_Info info =
+        transmitter.fill_info(44, PJON_NO_HEADER, 0, PJON_BROADCAST);
+      FrameLoopback::length = transmitter.compose_packet(
+        info, FrameLoopback::frame, payload, lengths[l]
+      );
+      received = 0;
+      double loop = packets_per_second(true);
+      double whole = packets_per_second(false);
+      if(received != 2 * ITERATIONS) printf("Reception failed\n");
+      printf(
+        "%7d  %-5s  %16.0f  %11.0f\n",
+        lengths[l],
+        crc_32 ? "CRC32" : "CRC8",
+        loop,
+        whole
+      );
+    }
+  return 0;
+};
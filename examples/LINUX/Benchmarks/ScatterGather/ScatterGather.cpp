@@ -0,0 +1,109 @@
+
+/* Measures the cost of sending 1KB payloads with send_packet_blocking using
+   GlobalUDP on localhost, without acknowledgement.
+
+   ScatterGatherCopy composes the packet in the buffer and UDPHelper copies
+   it again to prepend its magic header. ScatterGather is built with
+   PJON_INCLUDE_SCATTER_GATHER: header and CRC are composed apart and the
+   frame is transmitted with sendmsg, the payload is never copied.
+
+   Composition alone (compose_packet or compose_frame) and the whole
+   transmission are measured, a thread receives the datagrams to verify
+   they are all delivered. */
+
+#define PJON_PACKET_MAX_LENGTH 1100
+#define PJON_CRC32_MODE PJON_CRC32_CLMUL
+#include <PJONGlobalUDP.h>
+#include <thread>
+#include <atomic>
+
+#define PAYLOAD_LENGTH 1024
+#define COMPOSITIONS 1000000
+#define PACKETS 200000
+#define TX_PORT 7300
+#define RX_PORT 7301
+
+std::atomic<bool> running(true);
+std::atomic<uint32_t> received(0);
+
+uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+};
+
+void receive() {
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int size = 8 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  struct timeval timeout = {0, 10000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(RX_PORT);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (sockaddr *)&address, sizeof(address));
+  uint8_t buffer[1500];
+  while(running)
+    if(recv(fd, buffer, sizeof(buffer), 0) > PAYLOAD_LENGTH)
+      received++;
+  close(fd);
+};
+
+int main() {
+  PJONGlobalUDP bus(1);
+  const uint8_t localhost[4] = {127, 0, 0, 1};
+  bus.strategy.set_port(TX_PORT);
+  bus.strategy.add_node(2, localhost, RX_PORT);
+  bus.set_acknowledge(false);
+  bus.set_crc_32(true);
+  bus.begin();
+  std::thread receiver(receive);
+  PJON_DELAY(100);
+
+  uint8_t payload[PAYLOAD_LENGTH];
+  for(uint16_t i = 0; i < PAYLOAD_LENGTH; i++) payload[i] = rand();
+  PJON_Packet_Info info = bus.fill_info(2, PJON_NO_HEADER, 0, PJON_BROADCAST);
+  volatile uint32_t sink = 0;
+
+  uint64_t start = nanoseconds();
+  for(uint32_t i = 0; i < COMPOSITIONS; i++) {
+    payload[0] = i;
+    #if(PJON_INCLUDE_SCATTER_GATHER)
+      struct iovec frame[3];
+      sink += bus.compose_frame(info, frame, payload, PAYLOAD_LENGTH);
+    #else
+      sink += bus.compose_packet(info, bus.data, payload, PAYLOAD_LENGTH);
+    #endif
+  }
+  double compose_ns = (double)(nanoseconds() - start) / COMPOSITIONS;
+
+  uint32_t failures = 0;
+  start = nanoseconds();
+  for(uint32_t i = 0; i < PACKETS; i++) {
+    payload[0] = i;
+    if(bus.send_packet_blocking(info, payload, PAYLOAD_LENGTH) != PJON_ACK)
+      failures++;
+    // Do not overflow the receiver's socket buffer
+    if(!(i & 255)) while(received + 4096 < i) std::this_thread::yield();
+  }
+  double send_ns = (double)(nanoseconds() - start) / PACKETS;
+  PJON_DELAY(100);
+  running = false;
+  receiver.join();
+
+  printf(
+    "%s, %d bytes payload\n",
+    PJON_INCLUDE_SCATTER_GATHER ? "Scatter-gather (sendmsg)" : "Copy",
+    PAYLOAD_LENGTH
+  );
+  printf("Composition    %8.1f ns\n", compose_ns);
+  printf("Blocking send  %8.1f ns (%.0f packets/s)\n", send_ns, 1e9 / send_ns);
+  printf(
+    "Payload bytes copied per send: %d\n",
+    PJON_INCLUDE_SCATTER_GATHER ? 0 : 2 * PAYLOAD_LENGTH
+  );
+  printf("Delivered %u/%d, failures %u\n", (uint32_t)received, PACKETS, failures);
+  return 0;
+};
@@ -0,0 +1,136 @@
+/* Measures the system calls per frame and the maximum frame rate of two
+   ThroughSerial instances connected by a pseudo terminal pair. A frame is
+   transmitted, received, acknowledged and the acknowledgement is received,
+   in a single thread, waiting with poll for the data to be transferred by
+   the pseudo terminal. The system calls (read, write, ioctl and tcdrain) of
+   both instances are counted wrapping the functions at link time, the
+   Makefile builds the benchmark with the buffered serial access of Linux
+   (SerialIO) and with TS_UNBUFFERED defined (SerialIOUnbuffered). */
+
+#define PJON_PACKET_MAX_LENGTH 300
+// Wait for the transmission instead of discarding the pty's queues
+#define PJON_SERIAL_FLUSH(S) tcdrain(S)
+extern "C" int tcdrain(int fd);
+#include <PJONThroughSerial.h>
+#include <poll.h>
+
+#define DURATION_MS 2000
+
+uint32_t syscalls = 0;
+
+extern "C" {
+  ssize_t __real_read(int fd, void *buffer, size_t count);
+  ssize_t __real_write(int fd, const void *buffer, size_t count);
+  int __real_ioctl(int fd, unsigned long request, void *argument);
+  int __real_tcdrain(int fd);
+
+  ssize_t __wrap_read(int fd, void *buffer, size_t count) {
+    syscalls++;
+    return __real_read(fd, buffer, count);
+  };
+
+  ssize_t __wrap_write(int fd, const void *buffer, size_t count) {
+    syscalls++;
+    return __real_write(fd, buffer, count);
+  };
+
+  int __wrap_ioctl(int fd, unsigned long request, void *argument) {
+    syscalls++;
+    return __real_ioctl(fd, request, argument);
+  };
+
+  int __wrap_tcdrain(int fd) {
+    syscalls++;
+    return __real_tcdrain(fd);
+  };
+}
+
+int open_pty(int &other) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if(master < 0 || grantpt(master) || unlockpt(master)) return -1;
+  other = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if(other < 0) return -1;
+  struct termios2 config; // Raw mode, as serialOpen
+  if(ioctl(other, TCGETS2, &config)) return -1;
+  config.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP
+                   | INLCR | IGNCR | ICRNL | IXON);
+  config.c_cflag &= ~(CSIZE | PARENB);
+  config.c_cflag |= CS8;
+  config.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+  config.c_oflag &= ~OPOST;
+  config.c_cc[VMIN] = 0;
+  config.c_cc[VTIME] = 0;
+  if(ioctl(other, TCSETS2, &config)) return -1;
+  return master;
+};
+
+/* Waits for incoming data without polling (not counted): */
+
+void wait(int fd) {
+  struct pollfd descriptor = {fd, POLLIN, 0};
+  poll(&descriptor, 1, 100);
+};
+
+bool pending(ThroughSerial &strategy) {
+  #ifdef TS_BUFFERED
+    return strategy.pending();
+  #else
+    return strategy.state == TS_DONE;
+  #endif
+};
+
+void measure(ThroughSerial &a, ThroughSerial &b, uint16_t length) {
+  uint8_t frame[PJON_PACKET_MAX_LENGTH];
+  uint8_t received[PJON_PACKET_MAX_LENGTH];
+  for(uint16_t i = 0; i < length; i++) frame[i] = i; // Some to be escaped
+  uint32_t frames = 0, failures = 0, calls = syscalls;
+  uint32_t start = millis();
+  while((uint32_t)(millis() - start) < DURATION_MS) {
+    a.send_frame(frame, length);
+    uint16_t result = TS_FAIL;
+    for(uint16_t i = 0; (i < 100) && (result == TS_FAIL); i++) {
+      result = b.receive_frame(received, PJON_PACKET_MAX_LENGTH);
+      if((result == TS_FAIL) && !pending(b)) wait(b.get_fd());
+    }
+    if(result != length) {
+      failures++;
+      continue;
+    }
+    b.send_response(PJON_ACK);
+    wait(a.get_fd());
+    if(a.receive_response() == PJON_ACK) frames++;
+    else failures++;
+  }
+  printf(
+    "%5u bytes: %8.0f frames/s %6.1f syscalls/frame (%u failures)\n",
+    length,
+    frames * 1000.0 / DURATION_MS,
+    frames ? (double)(syscalls - calls) / frames : 0.0,
+    failures
+  );
+};
+
+int main() {
+  int other;
+  int master = open_pty(other);
+  if(master < 0) {
+    printf("Unable to open a pseudo terminal\n");
+    return 1;
+  }
+  ThroughSerial a, b;
+  a.set_serial(master);
+  b.set_serial(other);
+  a.set_read_interval(0);
+  b.set_read_interval(0);
+  #ifdef TS_BUFFERED
+    printf("Buffered serial access\n");
+  #else
+    printf("Unbuffered serial access\n");
+  #endif
+  measure(a, b, 16);
+  measure(a, b, 64);
+  measure(a, b, 250);
+  close(other);
+  close(master);
+  return 0;
+};
@@ -0,0 +1,163 @@
+
+/* Compares the cross-thread send latency and throughput of PJONThreaded
+   (lock-free rings) with the same runtime using a mutex-guarded std::deque
+   as send queue. The strategy transmits nothing, send_frame records the
+   time elapsed since the producer called send. Both bus threads yield
+   when idle (idle time 0) so the queue is the only difference. */
+
+#define PJON_MAX_PACKETS 32
+#include <PJONThreaded.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#define LATENCY_SAMPLES 20000
+#define THROUGHPUT_PACKETS 200000
+#define PAYLOAD_LENGTH 16
+
+uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+};
+
+std::atomic<uint32_t> transmitted(0);
+uint64_t latency[LATENCY_SAMPLES];
+
+struct Timestamp {
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  uint8_t get_max_attempts() { return 0; };
+  static uint32_t get_response_timeout() { return 0; };
+  uint32_t back_off(uint8_t) { return 0; };
+  void handle_collision() { };
+  uint16_t receive_frame(uint8_t *, uint16_t) { return PJON_FAIL; };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_response(uint8_t) { };
+
+  void send_frame(uint8_t *data, uint16_t length) {
+    uint64_t sent;
+    uint8_t crc = (data[1] & PJON_CRC_BIT) ? 4 : 1;
+    memcpy(&sent, data + length - crc - PAYLOAD_LENGTH, sizeof(sent));
+    uint32_t i = transmitted.load(std::memory_order_relaxed);
+    if(i < LATENCY_SAMPLES) latency[i] = nanoseconds() - sent;
+    transmitted.store(i + 1, std::memory_order_release);
+  };
+};
+
+/* The same runtime using a mutex-guarded queue: */
+
+class PJONMutexed {
+public:
+  PJON<Timestamp> bus;
+
+  PJONMutexed(uint8_t device_id) : bus(device_id) { };
+
+  void start() {
+    _running = true;
+    _thread = std::thread(&PJONMutexed::loop, this);
+  };
+
+  void stop() {
+    _running = false;
+    _thread.join();
+  };
+
+  bool send(uint8_t rx_id, const void *payload, uint16_t length) {
+    PJON_Threaded_Packet packet;
+    packet.info = bus.fill_info(rx_id, PJON_NO_HEADER, 0, PJON_BROADCAST);
+    packet.length = length;
+    memcpy(packet.payload, payload, length);
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_queue.size() >= PJON_THREADED_SEND_QUEUE) return false;
+    _queue.push_back(packet);
+    return true;
+  };
+
+private:
+  std::deque<PJON_Threaded_Packet> _queue;
+  std::mutex _mutex;
+  std::thread _thread;
+  std::atomic<bool> _running{false};
+
+  void loop() {
+    while(_running.load(std::memory_order_acquire)) {
+      bool dispatched = false;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        while(
+          !_queue.empty() && bus.get_packets_count() < PJON_MAX_PACKETS
+        ) {
+          PJON_Threaded_Packet &packet = _queue.front();
+          bus.dispatch(packet.info, packet.payload, packet.length);
+          _queue.pop_front();
+          dispatched = true;
+        }
+      }
+      bus.update();
+      bus.receive();
+      if(!dispatched) std::this_thread::yield();
+    }
+  };
+};
+
+template<typename Runtime>
+void send_timestamped(Runtime &runtime) {
+  uint8_t payload[PAYLOAD_LENGTH] = {0};
+  uint64_t now = nanoseconds();
+  memcpy(payload, &now, sizeof(now));
+  while(!runtime.send(45, payload, PAYLOAD_LENGTH)) std::this_thread::yield();
+};
+
+template<typename Runtime>
+void measure(const char *name, Runtime &runtime) {
+  runtime.bus.set_acknowledge(false);
+  runtime.start();
+  // Latency: one packet at a time
+  transmitted = 0;
+  for(uint32_t i = 0; i < LATENCY_SAMPLES; i++) {
+    send_timestamped(runtime);
+    while(transmitted.load(std::memory_order_acquire) <= i)
+      std::this_thread::yield();
+  }
+  std::sort(latency, latency + LATENCY_SAMPLES);
+  printf(
+    "%-12s  latency p50 %6.2f us  p99 %6.2f us\n",
+    name,
+    latency[LATENCY_SAMPLES / 2] / 1000.0,
+    latency[LATENCY_SAMPLES * 99 / 100] / 1000.0
+  );
+  // Throughput: producers send as fast as possible
+  for(uint8_t producers = 1; producers <= 4; producers *= 2) {
+    transmitted = LATENCY_SAMPLES;
+    uint32_t target = LATENCY_SAMPLES + THROUGHPUT_PACKETS;
+    uint64_t start = nanoseconds();
+    std::vector<std::thread> threads;
+    for(uint8_t p = 0; p < producers; p++)
+      threads.push_back(std::thread([&]() {
+        for(uint32_t i = 0; i < THROUGHPUT_PACKETS / producers; i++)
+          send_timestamped(runtime);
+      }));
+    for(std::thread &thread : threads) thread.join();
+    while(transmitted.load(std::memory_order_acquire) < target)
+      std::this_thread::yield();
+    printf(
+      "%-12s  %u producer%s %10.0f packets/s\n",
+      name,
+      producers,
+      (producers > 1) ? "s" : " ",
+      THROUGHPUT_PACKETS * 1e9 / (nanoseconds() - start)
+    );
+  }
+  runtime.stop();
+};
+
+int main() {
+  PJONThreaded<Timestamp> threaded(44);
+  threaded.set_idle_time(0);
+  measure("Lock-free", threaded);
+  PJONMutexed mutexed(44);
+  measure("Mutex", mutexed);
+  return 0;
+};
@@ -0,0 +1,88 @@
+
+/* Measures the overhead of tracing: Tracing is built with
+   PJON_INCLUDE_TRACE, TracingOff without it. A loopback strategy is used,
+   each iteration receives a 64 bytes frame (receive_frame, CRC and
+   receiver callback are traced) and sends a packet with send_packet
+   (send_frame and receive_response are traced).
+
+   Tracing writes the last records in trace.json, open it with
+   chrome://tracing or https://ui.perfetto.dev */
+
+#define PJON_PACKET_MAX_LENGTH 300
+#include <PJON.h>
+
+#define ITERATIONS 1000000
+
+uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+};
+
+struct Loopback {
+  static uint8_t frame[PJON_PACKET_MAX_LENGTH];
+  static uint16_t length;
+  static bool available;
+
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  uint8_t get_max_attempts() { return 0; };
+  uint32_t back_off(uint8_t) { return 0; };
+  void handle_collision() { };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_frame(uint8_t *, uint16_t) { };
+  void send_response(uint8_t) { };
+
+  uint16_t receive_frame(uint8_t *data, uint16_t) {
+    if(!available) return PJON_FAIL;
+    memcpy(data, frame, length);
+    return length;
+  };
+};
+
+uint8_t  Loopback::frame[PJON_PACKET_MAX_LENGTH];
+uint16_t Loopback::length;
+bool     Loopback::available = true;
+
+uint32_t received = 0;
+
+void receiver_function(uint8_t *, uint16_t, const PJON_Packet_Info &) {
+  received++;
+};
+
+PJON<Loopback> transmitter(1);
+PJON<Loopback> receiver(44);
+
+int main() {
+  uint8_t payload[64];
+  for(uint16_t i = 0; i < sizeof(payload); i++) payload[i] = rand();
+  receiver.set_receiver(receiver_function);
+  transmitter.set_crc_32(true);
+  PJON_Packet_Info info = transmitter.fill_info(44, PJON_NO_HEADER, 0, 0);
+  Loopback::length =
+    transmitter.compose_packet(info, Loopback::frame, payload, 64);
+
+  uint64_t start = nanoseconds();
+  for(uint32_t i = 0; i < ITERATIONS; i++) receiver.receive();
+  double receive_ns = (double)(nanoseconds() - start) / ITERATIONS;
+
+  start = nanoseconds();
+  for(uint32_t i = 0; i < ITERATIONS; i++)
+    transmitter.send_packet(44, payload, sizeof(payload));
+  double send_ns = (double)(nanoseconds() - start) / ITERATIONS;
+
+  if(received != ITERATIONS) printf("Reception failed\n");
+  printf(
+    "%s\nreceive     %6.1f ns\nsend_packet %6.1f ns\n",
+    PJON_INCLUDE_TRACE ? "Tracing enabled" : "Tracing disabled",
+    receive_ns,
+    send_ns
+  );
+  #if(PJON_INCLUDE_TRACE)
+    FILE *file = fopen("trace.json", "w");
+    PJON_Trace<>::dump(file);
+    fclose(file);
+    printf("Last %d records written in trace.json\n", PJON_TRACE_LENGTH);
+  #endif
+  return 0;
+};
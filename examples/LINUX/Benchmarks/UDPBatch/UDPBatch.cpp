@@ -0,0 +1,150 @@
+/* Measures the batched datagram I/O of the UDP helper used by GlobalUDP,
+   the Makefile builds the benchmark with PJON_INCLUDE_UDP_BATCH defined
+   (UDPBatch) and without (UDPSingle):
+   - fan-out latency: time to send a broadcast to 10, 100 and 1000 nodes
+     (all at a socket of 127.0.0.1 drained after each round, GlobalUDP
+     supports up to 254 nodes but the helper has no limit);
+   - receive throughput: a burst of a datagram from each of 10, 100 and 1000
+     nodes is queued in the socket and then drained with receive_frame.
+   The system calls (sendmsg, sendmmsg, recvmsg and recvmmsg) are counted
+   wrapping the functions at link time. */
+
+#include <PJON.h>
+#include <interfaces/LINUX/UDPHelper_POSIX.h>
+#include <algorithm>
+
+#define ROUNDS      200
+#define FRAME       32
+#define RX_PORT     7320
+#define TX_PORT     7321
+#define SINK_PORT   7322
+#define MAX_NODES   1000
+#define BURST       100 // Datagrams queued in the socket at once
+#define MAGIC       0x0DFAC3FF
+
+uint32_t syscalls = 0;
+
+extern "C" {
+  ssize_t __real_sendmsg(int fd, const struct msghdr *message, int flags);
+  ssize_t __real_recvmsg(int fd, struct msghdr *message, int flags);
+  int __real_sendmmsg(int fd, struct mmsghdr *v, unsigned int n, int flags);
+  int __real_recvmmsg(
+    int fd, struct mmsghdr *v, unsigned int n, int flags, struct timespec *t
+  );
+
+  ssize_t __wrap_sendmsg(int fd, const struct msghdr *message, int flags) {
+    syscalls++;
+    return __real_sendmsg(fd, message, flags);
+  };
+
+  ssize_t __wrap_recvmsg(int fd, struct msghdr *message, int flags) {
+    syscalls++;
+    return __real_recvmsg(fd, message, flags);
+  };
+
+  int __wrap_sendmmsg(int fd, struct mmsghdr *v, unsigned int n, int flags) {
+    syscalls++;
+    return __real_sendmmsg(fd, v, n, flags);
+  };
+
+  int __wrap_recvmmsg(
+    int fd, struct mmsghdr *v, unsigned int n, int flags, struct timespec *t
+  ) {
+    syscalls++;
+    return __real_recvmmsg(fd, v, n, flags, t);
+  };
+}
+
+uint64_t nanoseconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000000000ull + time.tv_nsec;
+};
+
+uint8_t  ip[MAX_NODES][4];
+uint16_t port[MAX_NODES];
+uint8_t  frame[FRAME];
+uint8_t  received[PJON_PACKET_MAX_LENGTH];
+
+double fan_out(UDPHelper &udp, UDPHelper &sink, uint16_t nodes, double &calls) {
+  static double time[ROUNDS];
+  uint32_t total = 0;
+  for(uint16_t r = 0; r < ROUNDS; r++) {
+    uint32_t before = syscalls;
+    uint64_t start = nanoseconds();
+    #if(PJON_INCLUDE_UDP_BATCH)
+      udp.send_frame(frame, FRAME, ip, port, nodes);
+    #else
+      for(uint16_t n = 0; n < nodes; n++)
+        udp.send_frame(frame, FRAME, ip[n], port[n]);
+    #endif
+    time[r] = (nanoseconds() - start) / 1000.0;
+    total += syscalls - before;
+    while(sink.receive_frame(received, sizeof(received)));
+  }
+  calls = (double)total / ROUNDS;
+  std::sort(time, time + ROUNDS);
+  return time[ROUNDS / 2];
+};
+
+double receive(UDPHelper &tx, UDPHelper &rx, uint16_t nodes, double &calls) {
+  uint64_t time = 0;
+  uint32_t count = 0, total = 0;
+  uint8_t localhost[4] = {127, 0, 0, 1};
+  for(uint16_t r = 0; r < ROUNDS / 10; r++)
+    for(uint16_t first = 0; first < nodes; first += BURST) {
+      uint16_t burst = std::min<uint16_t>(BURST, nodes - first);
+      for(uint16_t n = 0; n < burst; n++)
+        tx.send_frame(frame, FRAME, localhost, RX_PORT);
+      uint32_t before = syscalls;
+      uint64_t start = nanoseconds();
+      for(uint16_t n = 0; n < burst; n++)
+        if(rx.receive_frame(received, sizeof(received)) == FRAME) count++;
+      time += nanoseconds() - start;
+      total += syscalls - before;
+    }
+  calls = (double)total / (ROUNDS / 10);
+  return count / (time / 1000000000.0);
+};
+
+int main() {
+  UDPHelper tx, rx, sink;
+  if(!tx.begin(TX_PORT) || !rx.begin(RX_PORT) || !sink.begin(SINK_PORT)) {
+    printf("Unable to open the sockets\n");
+    return 1;
+  }
+  tx.set_magic_header(htonl(MAGIC));
+  rx.set_magic_header(htonl(MAGIC));
+  sink.set_magic_header(htonl(MAGIC));
+  for(uint16_t n = 0; n < MAX_NODES; n++) {
+    ip[n][0] = 127;
+    ip[n][1] = ip[n][2] = 0;
+    ip[n][3] = 1;
+    port[n] = SINK_PORT;
+  }
+  memset(frame, 'A', FRAME);
+  printf(
+    "%s, %u bytes frames\n",
+    PJON_INCLUDE_UDP_BATCH ? "Batched (sendmmsg, recvmmsg)" : "Single",
+    FRAME
+  );
+  printf(
+    "%6s %18s %10s %22s %10s\n",
+    "nodes", "fan-out p50 (us)", "syscalls", "receive (datagrams/s)", "syscalls"
+  );
+  const uint16_t nodes[] = {10, 100, 1000};
+  for(uint8_t i = 0; i < 3; i++) {
+    double send_calls, receive_calls;
+    double latency = fan_out(tx, sink, nodes[i], send_calls);
+    double rate = receive(tx, rx, nodes[i], receive_calls);
+    printf(
+      "%6u %18.1f %10.0f %22.0f %10.0f\n",
+      nodes[i],
+      latency,
+      send_calls,
+      rate,
+      receive_calls
+    );
+  }
+  return 0;
+};
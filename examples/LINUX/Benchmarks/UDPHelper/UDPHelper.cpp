@@ -0,0 +1,103 @@
+/* Measures the packets per second transmitted and received over loopback
+   by two UDPHelper instances (used by LocalUDP, GlobalUDP and DualUDP),
+   compared with the previous implementation that composed each frame in a
+   heap-allocated buffer (sendto) and shifted the received frame to remove
+   the magic header (recvfrom). A frame is sent and then received by the
+   other instance in the same thread. */
+
+#define PJON_PACKET_MAX_LENGTH 1500
+#include <PJON.h>
+#include <interfaces/LINUX/UDPHelper_POSIX.h>
+
+#define DURATION_MS 2000
+#define PORT_A      7310
+#define PORT_B      7311
+#define MAGIC       0x0DEADBEE
+
+const uint8_t localhost[4] = {127, 0, 0, 1};
+
+/* The previous send_frame and receive_frame: */
+
+struct Previous {
+  UDPHelper &udp;
+  int fd;
+  uint32_t magic;
+  sockaddr_in remote;
+
+  Previous(UDPHelper &helper, uint16_t remote_port) : udp(helper) {
+    fd = udp.get_fd();
+    magic = MAGIC;
+    memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(remote_port);
+    memcpy(&remote.sin_addr.s_addr, localhost, 4);
+  };
+
+  void send_frame(const uint8_t *string, uint16_t length) {
+    char *buffer = new char[4 + length];
+    memcpy(buffer, &magic, 4);
+    memcpy(&buffer[4], string, length);
+    sendto(fd, buffer, 4 + length, 0, (const sockaddr *)&remote, sizeof(remote));
+    delete[] buffer;
+  };
+
+  uint16_t receive_frame(uint8_t *string, uint16_t max_length) {
+    struct sockaddr_storage source;
+    socklen_t source_length = sizeof(source);
+    ssize_t count = recvfrom(
+      fd, (char *)string, max_length, 0, (struct sockaddr *)&source, &source_length
+    );
+    if(count == -1 || count == max_length || count < 4) return 0;
+    uint32_t header = 0;
+    memcpy(&header, string, 4);
+    if(header != magic) return 0;
+    for(uint16_t i = 0; i < count - 4; i++) string[i] = string[i + 4];
+    return count - 4;
+  };
+};
+
+template<typename Send, typename Receive>
+void measure(const char *name, uint16_t length, Send send, Receive receive) {
+  uint8_t frame[PJON_PACKET_MAX_LENGTH];
+  uint8_t received[PJON_PACKET_MAX_LENGTH + 4];
+  memset(frame, 'A', length);
+  uint32_t packets = 0, failures = 0;
+  uint32_t start = millis();
+  while((uint32_t)(millis() - start) < DURATION_MS) {
+    send(frame, length);
+    if(receive(received, sizeof(received)) == length) packets++;
+    else failures++;
+  }
+  printf(
+    "%-10s %5u bytes: %8.0f packets/s (%u failures)\n",
+    name,
+    length,
+    packets * 1000.0 / DURATION_MS,
+    failures
+  );
+};
+
+int main() {
+  UDPHelper a, b;
+  if(!a.begin(PORT_A) || !b.begin(PORT_B)) {
+    printf("Unable to open the sockets\n");
+    return 1;
+  }
+  a.set_magic_header(MAGIC);
+  b.set_magic_header(MAGIC);
+  Previous previous_a(a, PORT_B), previous_b(b, PORT_A);
+  const uint16_t lengths[] = {16, 256, 1400};
+  for(uint8_t l = 0; l < 3; l++) {
+    measure("previous", lengths[l],
+      [&](const uint8_t *f, uint16_t n) { previous_a.send_frame(f, n); },
+      [&](uint8_t *r, uint16_t m) { return previous_b.receive_frame(r, m); }
+    );
+    measure("iovec", lengths[l],
+      [&](const uint8_t *f, uint16_t n) {
+        a.send_frame(f, n, (uint8_t *)localhost, PORT_B);
+      },
+      [&](uint8_t *r, uint16_t m) { return b.receive_frame(r, m); }
+    );
+  }
+  return 0;
+};
@@ -0,0 +1,48 @@
+
+/* Measures the average duration of an update() call as the number of
+   packets waiting in the buffer grows. Packets are scheduled with
+   send_repeatedly and a long interval, so most update() calls have nothing
+   to transmit, as it happens on a mostly idle gateway.
+
+   The Makefile builds UpdateCost using the linear scan of the packet buffer
+   and UpdateCostScheduler defining PJON_INCLUDE_SCHEDULER. */
+
+#define PJON_MAX_PACKETS 1024
+#include <PJON.h>
+
+#define ITERATIONS 20000
+
+struct Idle {
+  bool begin(uint8_t = 0) { return true; };
+  bool can_start() { return true; };
+  uint8_t get_max_attempts() { return 10; };
+  uint32_t back_off(uint8_t attempts) { return attempts * 1000; };
+  void handle_collision() { };
+  uint16_t receive_frame(uint8_t *, uint16_t) { return PJON_FAIL; };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_response(uint8_t) { };
+  void send_frame(uint8_t *, uint16_t) { };
+};
+
+PJON<Idle> bus(1);
+
+int main() {
+  printf(
+    "Scheduler: %s\n", PJON_INCLUDE_SCHEDULER ? "min-heap" : "linear scan"
+  );
+  printf("Queue depth  ns per update()\n");
+  uint16_t depth = 0;
+  for(uint16_t target = 1; target <= PJON_MAX_PACKETS; target *= 4) {
+    while(depth < target) {
+      bus.send_repeatedly(2, "sensor", 6, 60000000); // Every minute
+      depth++;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < ITERATIONS; i++) bus.update();
+    double elapsed = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start
+    ).count();
+    printf("%11d %16.1f\n", depth, elapsed / ITERATIONS);
+  }
+  return 0;
+};
@@ -0,0 +1,39 @@
+// Sends P to device 44 (see PingPong/Receiver) and awaits its reply
+#define PJON_INCLUDE_COROUTINES
+#include <PJONGlobalUDP.h>
+
+PJONGlobalUDP bus(45);
+
+// Address of remote device
+const uint8_t remote_ip[] = { 192, 1, 1, 151 };
+
+uint32_t replies = 0;
+uint32_t failures = 0;
+bool done = false;
+
+PJON_Task ping(uint32_t count) {
+  for(uint32_t i = 0; i < count; i++) {
+    if(co_await bus.send_async(44, "P", 1) != PJON_ACK) {
+      failures++;
+      continue;
+    }
+    // Wait up to 100 milliseconds for the reply of device 44
+    PJON_Reply reply = co_await bus.receive_async(44, PJON_BROADCAST, 100000);
+    if(reply.result == PJON_ACK && reply.payload[0] == 'P') replies++;
+    else failures++;
+  }
+  done = true;
+};
+
+int main() {
+  bus.strategy.add_node(44, remote_ip, 16001);
+  bus.strategy.set_port(16000);
+  bus.begin();
+  ping(1000);
+
+  while(!done) {
+    bus.update();
+    bus.receive();
+  }
+  printf("Replies: %u Failures: %u\n", replies, failures);
+}
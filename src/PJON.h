@@ -61,6 +61,48 @@ limitations under the License. */
 #include "interfaces/PJON_Interfaces.h"
 #include "PJONDefines.h"
 
+#include "utils/header/PJON_Header_Policy.h"
+#include "utils/backoff/PJON_Back_Off.h"
+
+#if(PJON_INCLUDE_SCHEDULER)
+  #include "utils/scheduler/PJON_Scheduler.h"
+#endif
+
+#if(PJON_INCLUDE_PACKET_ARENA)
+  #include "utils/arena/PJON_Packet_Arena.h"
+#endif
+
+#if(PJON_INCLUDE_PRIORITY)
+  #include "utils/priority/PJON_Priority_Queues.h"
+#endif
+
+#if(PJON_INCLUDE_PACKET_ID && PJON_INCLUDE_PACKET_ID_HASH)
+  #include "utils/packet_id/PJON_Packet_Id_Set.h"
+#endif
+
+#if(PJON_INCLUDE_SCATTER_GATHER)
+  #include "utils/gather/PJON_Scatter_Gather.h"
+#endif
+
+#if(PJON_INCLUDE_PIPELINED_ACK)
+  #include "utils/ack/PJON_Pipelined_Ack.h"
+#endif
+
+#if(PJON_INCLUDE_STATS)
+  #include "utils/stats/PJON_Stats.h"
+#endif
+
+#if(PJON_INCLUDE_TRACE)
+  #include "utils/trace/PJON_Trace.h"
+#else
+  #define PJON_TRACE_START(start)
+  #define PJON_TRACE_STOP(event, start, length)
+#endif
+
+#if(PJON_INCLUDE_COROUTINES)
+  #include "utils/coroutine/PJON_Coroutine.h"
+#endif
+
 #ifdef CROC
   #include "util_cpp.h"
 #endif
@@ -77,17 +119,22 @@ static void PJON_dummy_error_handler(
   void *                    // custom_pointer
 ) {};
 
-template<typename Strategy>
+template<typename Strategy, typename Header = PJON_Dynamic_Header>
 class PJON {
   public:
     Strategy strategy;
-    uint8_t config = PJON_TX_INFO_BIT | PJON_ACK_REQ_BIT;
+    uint8_t config = Header::config;
     uint8_t data[PJON_PACKET_MAX_LENGTH];
     PJON_Packet_Info last_packet_info;
     PJON_Packet packets[PJON_MAX_PACKETS];
+    #if(PJON_INCLUDE_PACKET_ARENA)
+      PJON_Packet_Arena<PJON_PACKET_ARENA_LENGTH> arena;
+    #endif
     PJON_Endpoint tx;
 
-    #if(PJON_INCLUDE_PACKET_ID)
+    #if(PJON_INCLUDE_PACKET_ID && PJON_INCLUDE_PACKET_ID_HASH)
+      PJON_Packet_Id_Set<PJON_MAX_RECENT_PACKET_IDS> recent_packet_ids;
+    #elif(PJON_INCLUDE_PACKET_ID)
       PJON_Packet_Record recent_packet_ids[PJON_MAX_RECENT_PACKET_IDS];
     #endif
 
@@ -165,6 +212,53 @@ class PJON {
       const void *source,
       uint16_t length
     ) {
+      complete_info(info);
+      uint16_t l = Header::compose_packet(info, destination, source, length);
+      if(l < PJON_PACKET_MAX_LENGTH) return l;
+      _error(PJON_CONTENT_TOO_LONG, l, _custom_pointer);
+      return 0;
+    };
+
+    #if(PJON_INCLUDE_SCATTER_GATHER)
+
+      /* Compose header and CRC of a packet in data, the 3 segments of frame
+         point to the header, to the payload (not copied) and to the CRC: */
+
+      uint16_t compose_frame(
+        PJON_Packet_Info info,
+        struct iovec *frame,
+        const void *payload,
+        uint16_t length
+      ) {
+        complete_info(info);
+        uint16_t l = Header::compose_header(info, data, length);
+        if(l >= PJON_PACKET_MAX_LENGTH) {
+          _error(PJON_CONTENT_TOO_LONG, l, _custom_pointer);
+          return 0;
+        }
+        uint8_t crc_length = PJONTools::crc_overhead(data[1]);
+        uint8_t header_length = l - length - crc_length;
+        PJONTools::compose_crc(
+          data + header_length,
+          data,
+          header_length,
+          payload,
+          length
+        );
+        frame[0].iov_base = data;
+        frame[0].iov_len = header_length;
+        frame[1].iov_base = const_cast<void *>(payload);
+        frame[1].iov_len = length;
+        frame[2].iov_base = data + header_length;
+        frame[2].iov_len = crc_length;
+        return l;
+      };
+
+    #endif
+
+    /* Fill the info of a packet about to be composed: */
+
+    void complete_info(PJON_Packet_Info &info) {
       info.header = (info.header == PJON_NO_HEADER) ? config : info.header;
       info.tx = tx;
       #if(PJON_INCLUDE_PACKET_ID)
@@ -181,12 +275,6 @@ class PJON {
         if(info.header & PJON_MAC_BIT)
           PJONTools::copy_id(info.tx.mac, tx.mac, 6);
       #endif
-      uint16_t l = PJONTools::compose_packet(
-        info, destination, source, length
-      );
-      if(l < PJON_PACKET_MAX_LENGTH) return l;
-      _error(PJON_CONTENT_TOO_LONG, l, _custom_pointer);
-      return 0;
     };
 
     /* Get device id: */
@@ -202,33 +290,150 @@ class PJON {
       uint32_t timing = 0,
       uint16_t packet_index = PJON_FAIL
     ) {
-      bool p = (packet_index != PJON_FAIL);
-      for(uint16_t i = ((p) ? packet_index : 0); i < PJON_MAX_PACKETS; i++)
-        if(packets[i].state == 0 || p) {
-          if(!(length = compose_packet(
-            info, packets[i].content, packet, length
-          ))) return PJON_FAIL;
-          packets[i].length = length;
-          packets[i].state = PJON_TO_BE_SENT;
-          packets[i].registration = PJON_MICROS();
-          packets[i].timing = timing;
-          return i;
+      uint16_t i = (packet_index != PJON_FAIL) ? packet_index : free_slot();
+      if(i < PJON_MAX_PACKETS) {
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          land(i); // Replaced while waiting for its acknowledgement
+        #endif
+        #if(PJON_INCLUDE_PACKET_ARENA)
+          if(!allocate_content(i, info, length)) {
+            _error(PJON_PACKETS_BUFFER_FULL, PJON_MAX_PACKETS, _custom_pointer);
+            return PJON_FAIL;
+          }
+        #endif
+        if(!(length = compose_packet(
+          info, packets[i].content, packet, length
+        ))) {
+          #if(PJON_INCLUDE_PACKET_ARENA)
+            if(!packets[i].state) {
+              arena.release(packets[i].content);
+              packets[i].content = NULL;
+            }
+          #endif
+          return PJON_FAIL;
         }
+        packets[i].length = length;
+        if(!packets[i].state) _packets_count++;
+        packets[i].state = PJON_TO_BE_SENT;
+        packets[i].registration = PJON_MICROS();
+        packets[i].timing = timing;
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          if(packets[i].content[1] & PJON_PACKET_ID_BIT) {
+            PJON_Packet_Info sent;
+            Header::parse_header(packets[i].content, sent);
+            packets[i].id = sent.id;
+          }
+        #endif
+        #if(PJON_INCLUDE_PRIORITY)
+          packets[i].priority = packet_priority(info, packets[i].content);
+          _queues.push(i, packets[i].priority);
+        #endif
+        #if(PJON_INCLUDE_SCHEDULER)
+          _scheduler.take(i);
+          schedule(i);
+        #endif
+        #if(PJON_INCLUDE_STATS)
+          if(_packets_count > _stats.queue_high_water)
+            _stats.queue_high_water = _packets_count;
+        #endif
+        return i;
+      }
       _error(PJON_PACKETS_BUFFER_FULL, PJON_MAX_PACKETS, _custom_pointer);
       return PJON_FAIL;
     };
 
+    #if(PJON_INCLUDE_PACKET_ARENA)
+
+      /* Allocate from the arena a block able to contain the packet composed
+         using info, the length is estimated considering all the optional
+         fields compose_packet may add: */
+
+      bool allocate_content(
+        uint16_t i,
+        const PJON_Packet_Info &info,
+        uint16_t length
+      ) {
+        uint8_t header = (info.header == PJON_NO_HEADER) ? config : info.header;
+        header |= PJON_CRC_BIT | PJON_EXT_LEN_BIT;
+        #if(PJON_INCLUDE_PORT)
+          header |= PJON_PORT_BIT;
+        #endif
+        uint32_t needed =
+          (uint32_t)length + PJONTools::packet_overhead(header);
+        if(needed > PJON_PACKET_MAX_LENGTH) needed = PJON_PACKET_MAX_LENGTH;
+        if(
+          packets[i].content &&
+          (PJON_Packet_Arena<PJON_PACKET_ARENA_LENGTH>::capacity(
+            packets[i].content
+          ) >= needed)
+        ) return true;
+        uint8_t *block = arena.allocate(needed);
+        if(!block) return false;
+        arena.release(packets[i].content);
+        packets[i].content = block;
+        return true;
+      };
+
+    #endif
+
+    /* Returns the index of a free slot of the packet buffer: */
+
+    uint16_t free_slot() const {
+      #if(PJON_INCLUDE_SCHEDULER)
+        return _scheduler.free_slot();
+      #else
+        for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++)
+          if(packets[i].state == 0) return i;
+        return PJON_FAIL;
+      #endif
+    };
+
     /* Returns a pointer to the bus id used by the instance: */
 
     const uint8_t *get_bus_id() const {
       return tx.bus_id;
     };
 
+    #if(PJON_INCLUDE_STATS)
+
+      /* Get a snapshot of the statistics, optionally resetting them: */
+
+      PJON_Stats get_stats(bool reset = false) {
+        PJON_Stats snapshot = _stats;
+        if(reset) reset_stats();
+        return snapshot;
+      };
+
+      /* Reset the statistics, the high-water mark restarts from the packets
+         present in the buffer: */
+
+      void reset_stats() {
+        _stats = PJON_Stats();
+        _stats.queue_high_water = _packets_count;
+      };
+
+    #endif
+
+    #if(PJON_INCLUDE_TRACE)
+
+      /* Set the id of the instance in the trace (device id by default): */
+
+      void set_trace_id(uint8_t id) {
+        _trace_id = id;
+      };
+
+      uint8_t trace_id() const {
+        return (_trace_id != PJON_NOT_ASSIGNED) ? _trace_id : tx.id;
+      };
+
+    #endif
+
     /* Get count of packets:
        Don't pass any parameter to count all dispatched packets
        Pass a device id to count all it's related packets */
 
     uint16_t get_packets_count(uint8_t device_id = PJON_NOT_ASSIGNED) const {
+      if(device_id == PJON_NOT_ASSIGNED) return _packets_count;
       uint16_t packets_count = 0;
       for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
         if(packets[i].state == 0) continue;
@@ -268,7 +473,7 @@ class PJON {
     /* Calculate packet overhead: */
 
     uint8_t packet_overhead(uint8_t header = PJON_NO_HEADER) const {
-      return PJONTools::packet_overhead(
+      return Header::packet_overhead(
         (header == PJON_NO_HEADER) ? config : header
       );
     };
@@ -276,22 +481,85 @@ class PJON {
     /* Fill a PJON_Packet_Info struct with data parsing a packet: */
 
     void parse(const uint8_t *packet, PJON_Packet_Info &packet_info) const {
-      PJONTools::parse_header(packet, packet_info);
+      Header::parse_header(packet, packet_info);
       packet_info.custom_pointer = _custom_pointer;
     };
 
     /* Try to receive data: */
 
     uint16_t receive() {
+      PJON_TRACE_START(trace_start);
+      uint16_t batch_length =
+        strategy.receive_frame(data, PJON_PACKET_MAX_LENGTH);
+      if(batch_length == PJON_FAIL || batch_length == 0) return PJON_FAIL;
+      PJON_TRACE_STOP(PJON_TRACE_RECEIVE_FRAME, trace_start, batch_length);
+      // The whole frame was received with a single receive_frame call
+      uint16_t result = ((batch_length > 3) && (frame_length() <= batch_length))
+        ? receive_whole_frame() : receive_stream(batch_length);
+      #if(PJON_INCLUDE_STATS)
+        count_reception(result);
+      #endif
+      return result;
+    };
+
+    /* Validate a frame received at once: */
+
+    uint16_t receive_whole_frame() {
+      bool drop =
+        (data[0] != tx.id) && (data[0] != PJON_BROADCAST) && !_router;
+      if(!acceptable_header(drop)) return PJON_BUSY;
+      bool mac = data[1] & PJON_MAC_BIT;
+      uint8_t extended_length = (data[1] & PJON_EXT_LEN_BIT) ? 1 : 0;
+      uint8_t overhead = packet_overhead(data[1]);
+      uint16_t length = frame_length();
+      if(!acceptable_length(length, overhead)) return PJON_BUSY;
+      if(
+        (data[1] & PJON_MODE_BIT) && !_router && !mac &&
+        !PJONTools::id_equality( // Do not reject localhost
+          data + 4 + extended_length,
+          (config & PJON_MODE_BIT) ? tx.bus_id : PJONTools::localhost(),
+          4
+        )
+      ) return PJON_BUSY;
+      uint8_t crc = PJON_crc8::compute(data, 3 + extended_length);
+      if(crc != data[3 + extended_length]) return PJON_NAK;
+      PJON_TRACE_START(trace_start);
+      if(data[1] & PJON_CRC_BIT) {
+        if(!PJON_crc32::compare(
+          PJON_crc32::compute(data, length - 4),
+          data + (length - 4)
+        )) return PJON_NAK;
+      } else if( // The header's CRC8 is the start of the frame's CRC8
+        PJON_crc8::update(
+          crc,
+          data + 3 + extended_length,
+          length - 4 - extended_length
+        ) != data[length - 1]
+      ) return PJON_NAK;
+      PJON_TRACE_STOP(PJON_TRACE_CRC, trace_start, length);
+      return accept_frame(length, overhead, mac);
+    };
+
+    /* Validate a frame while it is received, batch_length bytes are already
+       present in the buffer: */
+
+    uint16_t receive_stream(uint16_t batch_length) {
       uint16_t length = PJON_PACKET_MAX_LENGTH;
-      uint16_t batch_length = 0;
+      uint16_t crc_index = 0;
+      uint32_t crc = 0;
       uint8_t  overhead = 0;
+      uint16_t header_end = PJON_PACKET_MAX_LENGTH; // Header CRC position
       bool extended_length = false, mac = false, drop = false;
       for(uint16_t i = 0; i < length; i++) {
         if(!batch_length) {
+          /* Fold the bytes already received in the CRC while waiting,
+             so it is ready as soon as the last byte arrives */
+          if(i > 1) crc_fold(crc, crc_index, i, length);
+          PJON_TRACE_START(trace_start);
           batch_length = strategy.receive_frame(data + i, length - i);
           if(batch_length == PJON_FAIL || batch_length == 0)
             return PJON_FAIL;
+          PJON_TRACE_STOP(PJON_TRACE_RECEIVE_FRAME, trace_start, batch_length);
         }
         batch_length--;
 
@@ -301,42 +569,21 @@ class PJON {
 
         if(i == 1) {
           mac = (data[1] & PJON_MAC_BIT);
-          if(
-            (
-              !_router &&
-              ((config & PJON_MODE_BIT) && !(data[1] & PJON_MODE_BIT))
-            ) || (
-              (data[0] == PJON_BROADCAST) && (data[1] & PJON_ACK_REQ_BIT)
-            ) || (
-              (data[1] & PJON_EXT_LEN_BIT) && !(data[1] & PJON_CRC_BIT)
-            ) || (
-              !PJON_INCLUDE_PACKET_ID && (data[1] & PJON_PACKET_ID_BIT)
-            ) || (
-              !PJON_INCLUDE_PORT && (data[1] & PJON_PORT_BIT)
-            ) || (
-              (!PJON_INCLUDE_MAC && mac) || (mac && !(data[1] & PJON_CRC_BIT))
-            ) || (drop && !mac)
-          ) return PJON_BUSY;
+          if(!acceptable_header(drop)) return PJON_BUSY;
           extended_length = data[i] & PJON_EXT_LEN_BIT;
           overhead = packet_overhead(data[i]);
+          header_end = 3 + extended_length;
+          if((data[1] & PJON_MODE_BIT) && !_router && !mac) header_end += 4;
         }
 
         if((i == 2) && !extended_length) {
           length = data[i];
-          if(
-            length < (uint8_t)(overhead + 1) ||
-            length >= PJON_PACKET_MAX_LENGTH
-          ) return PJON_BUSY;
-          if(length > 15 && !(data[1] & PJON_CRC_BIT)) return PJON_BUSY;
+          if(!acceptable_length(length, overhead)) return PJON_BUSY;
         }
 
         if((i == 3) && extended_length) {
           length = (data[i - 1] << 8) | (data[i] & 0xFF);
-          if(
-            length < (uint8_t)(overhead + 1) ||
-            length >= PJON_PACKET_MAX_LENGTH
-          ) return PJON_BUSY;
-          if(length > 15 && !(data[1] & PJON_CRC_BIT)) return PJON_BUSY;
+          if(!acceptable_length(length, overhead)) return PJON_BUSY;
         }
 
         if(
@@ -349,59 +596,23 @@ class PJON {
               return PJON_BUSY;
           } else if(data[i] != 0) return PJON_BUSY; // Do not reject localhost
         }
-      }
 
-      if(
-        PJON_crc8::compute(data, 3 + extended_length) !=
-        data[3 + extended_length]
-      ) return PJON_NAK;
-
-      if(data[1] & PJON_CRC_BIT) {
         if(
-          !PJON_crc32::compare(
-            PJON_crc32::compute(data, length - 4), data + (length - 4)
+          (i == header_end) &&
+          (
+            PJON_crc8::compute(data, 3 + extended_length) !=
+            data[3 + extended_length]
           )
         ) return PJON_NAK;
-      } else if(PJON_crc8::compute(data, length - 1) != data[length - 1])
-        return PJON_NAK;
-
-      #if(PJON_INCLUDE_MAC)
-        if(mac && (length > 15) && !_router)
-          if(!PJONTools::id_equality(data + (overhead - 16), tx.mac, 6))
-            if(!
-              PJONTools::id_equality(
-                data + (overhead - 16),
-                PJONTools::no_mac(), 6
-              )
-            ) return PJON_BUSY;
-      #endif
-
-      if(data[1] & PJON_ACK_REQ_BIT && data[0] != PJON_BROADCAST)
-        if((_mode != PJON_SIMPLEX) && !_router)
-          strategy.send_response(PJON_ACK);
-
-      parse(data, last_packet_info);
-
-      #if(PJON_INCLUDE_PACKET_ID)
-        if(
-          !_router &&
-          (last_packet_info.header & PJON_PACKET_ID_BIT) &&
-          known_packet_id(last_packet_info)
-        ) return PJON_ACK;
-      #endif
-
-      #if(PJON_INCLUDE_PORT)
-        if((port != PJON_BROADCAST) && (port != last_packet_info.port))
-          return PJON_BUSY;
-      #endif
-
-      _receiver(
-        data + (overhead - PJONTools::crc_overhead(data[1])),
-        length - overhead,
-        last_packet_info
-      );
+      }
 
-      return PJON_ACK;
+      PJON_TRACE_START(trace_start);
+      crc_fold(crc, crc_index, length, length);
+      if(data[1] & PJON_CRC_BIT) {
+        if(!PJON_crc32::compare(crc, data + (length - 4))) return PJON_NAK;
+      } else if((uint8_t)crc != data[length - 1]) return PJON_NAK;
+      PJON_TRACE_STOP(PJON_TRACE_CRC, trace_start, length);
+      return accept_frame(length, overhead, mac);
     };
 
     /* Try to receive data repeatedly with a maximum duration: */
@@ -420,11 +631,42 @@ class PJON {
     /* Remove a packet from buffer: */
 
     void remove(uint16_t index) {
+      release(index);
+      #if(PJON_INCLUDE_COROUTINES)
+        resume_senders();
+      #endif
+    };
+
+    /* Same as remove, the coroutine awaiting the packet is resumed later by
+       resume_senders: */
+
+    void release(uint16_t index) {
       if((index >= 0) && (index < PJON_MAX_PACKETS)) {
+        #if(PJON_INCLUDE_COROUTINES)
+          bool delivered = packets[index].state == PJON_ACK;
+        #endif
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          land(index);
+        #endif
+        if(packets[index].state) _packets_count--;
         packets[index].attempts = 0;
         packets[index].length = 0;
         packets[index].registration = 0;
         packets[index].state = 0;
+        #if(PJON_INCLUDE_PACKET_ARENA)
+          arena.release(packets[index].content);
+          packets[index].content = NULL;
+        #endif
+        #if(PJON_INCLUDE_SCHEDULER)
+          _scheduler.unschedule(index);
+          _scheduler.release(index);
+        #endif
+        #if(PJON_INCLUDE_PRIORITY)
+          _queues.remove(index);
+        #endif
+        #if(PJON_INCLUDE_COROUTINES)
+          complete_sender(index, delivered ? PJON_ACK : PJON_FAIL);
+        #endif
       }
     };
 
@@ -435,8 +677,11 @@ class PJON {
     void remove_all_packets(uint8_t device_id = 0) {
       for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
         if(packets[i].state == 0) continue;
-        if(!device_id || packets[i].content[0] == device_id) remove(i);
+        if(!device_id || packets[i].content[0] == device_id) release(i);
       }
+      #if(PJON_INCLUDE_COROUTINES)
+        resume_senders();
+      #endif
     };
 
     /* Reset a packet sending present in the buffer: */
@@ -444,13 +689,36 @@ class PJON {
     bool reset_packet(uint16_t id) {
       if(!packets[id].timing) {
         if(_auto_delete) {
-          remove(id);
+          release(id);
           return true;
         }
+        #if(PJON_INCLUDE_COROUTINES)
+          // Kept in the buffer until removed, its coroutine is resumed now
+          complete_sender(
+            id,
+            (packets[id].state == PJON_ACK) ? PJON_ACK : PJON_FAIL
+          );
+        #endif
       } else {
+        #if(PJON_INCLUDE_COROUTINES)
+          bool delivered = packets[id].state == PJON_ACK;
+        #endif
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          land(id);
+        #endif
         packets[id].attempts = 0;
         packets[id].registration = PJON_MICROS();
         packets[id].state = PJON_TO_BE_SENT;
+        #if(PJON_INCLUDE_PRIORITY)
+          _queues.push(id, packets[id].priority); // Back to the end
+        #endif
+        #if(PJON_INCLUDE_SCHEDULER)
+          schedule(id);
+        #endif
+        #if(PJON_INCLUDE_COROUTINES)
+          // A repeated packet resumes its coroutine after the first attempt
+          complete_sender(id, delivered ? PJON_ACK : PJON_FAIL);
+        #endif
       }
       return false;
     };
@@ -503,6 +771,59 @@ class PJON {
       return dispatch(info, payload, length);
     };
 
+    #if(PJON_INCLUDE_COROUTINES)
+
+      /* Schedule a packet sending and return an awaitable, the coroutine is
+         resumed by update when the packet is delivered (PJON_ACK) or lost
+         (PJON_FAIL), or at once if it can't be dispatched (PJON_FAIL):
+
+         uint16_t result = co_await bus.send_async(44, "B", 1); */
+
+      PJON_Send_Awaiter send_async(
+        uint8_t rx_id,
+        const void *payload,
+        uint16_t length,
+        uint8_t  header = PJON_NO_HEADER,
+        uint16_t packet_id = 0,
+        uint16_t rx_port = PJON_BROADCAST
+      ) {
+        PJON_Packet_Info info = fill_info(rx_id, header, packet_id, rx_port);
+        return send_async(info, payload, length);
+      };
+
+      PJON_Send_Awaiter send_async(
+        const PJON_Packet_Info &info,
+        const void *payload,
+        uint16_t length
+      ) {
+        uint16_t i = dispatch(info, payload, length);
+        return PJON_Send_Awaiter((i < PJON_MAX_PACKETS) ? &_senders[i] : NULL);
+      };
+
+      /* Return an awaitable resumed by receive when a packet is received from
+         tx_id (PJON_NOT_ASSIGNED for any sender) on port (PJON_BROADCAST for
+         any port), or by update after timeout microseconds (0 waits
+         indefinitely). The packet is not passed to the receiver function:
+
+         PJON_Reply reply = co_await bus.receive_async(44, 8001, 100000);
+         if(reply.result == PJON_ACK) use(reply.payload, reply.length); */
+
+      PJON_Reply_Awaiter receive_async(
+        uint8_t tx_id = PJON_NOT_ASSIGNED,
+        uint16_t rx_port = PJON_BROADCAST,
+        uint32_t timeout = 0
+      ) {
+        PJON_Reply_Awaiter awaiter;
+        awaiter.slots = _replies;
+        awaiter.count = PJON_MAX_REPLY_AWAITERS;
+        awaiter.tx_id = tx_id;
+        awaiter.port = rx_port;
+        awaiter.timeout = timeout;
+        return awaiter;
+      };
+
+    #endif
+
     /* Forward a packet:  */
 
     uint16_t forward(
@@ -566,16 +887,39 @@ class PJON {
 
     uint16_t send_packet(const uint8_t *payload, uint16_t length) {
       if(!payload) return PJON_FAIL;
-      if(_mode != PJON_SIMPLEX && !strategy.can_start()) return PJON_BUSY;
+      if(_mode != PJON_SIMPLEX && !strategy.can_start()) return busy();
+      PJON_TRACE_START(trace_start);
       strategy.send_frame((uint8_t *)payload, length);
-      if(
-        payload[0] == PJON_BROADCAST ||
-        !(payload[1] & PJON_ACK_REQ_BIT) ||
-        _mode == PJON_SIMPLEX
-      ) return PJON_ACK;
-      return (strategy.receive_response() == PJON_ACK) ? PJON_ACK : PJON_FAIL;
+      PJON_TRACE_STOP(PJON_TRACE_SEND_FRAME, trace_start, length);
+      #if(PJON_INCLUDE_STATS)
+        _stats.transmitted(length);
+      #endif
+      return response(payload);
     };
 
+    #if(PJON_INCLUDE_SCATTER_GATHER)
+
+      /* Transmit a frame composed by compose_frame: */
+
+      uint16_t send_frame(const struct iovec *frame) {
+        if(_mode != PJON_SIMPLEX && !strategy.can_start()) return busy();
+        PJON_TRACE_START(trace_start);
+        PJON_Scatter_Gather<Strategy>::send_frame_v(strategy, frame, 3);
+        PJON_TRACE_STOP(
+          PJON_TRACE_SEND_FRAME,
+          trace_start,
+          frame[0].iov_len + frame[1].iov_len + frame[2].iov_len
+        );
+        #if(PJON_INCLUDE_STATS)
+          _stats.transmitted(
+            frame[0].iov_len + frame[1].iov_len + frame[2].iov_len
+          );
+        #endif
+        return response((const uint8_t *)frame[0].iov_base);
+      };
+
+    #endif
+
     /* Compose and transmit a packet passing its info as parameters: */
 
     uint16_t send_packet(
@@ -587,9 +931,7 @@ class PJON {
       uint16_t rx_port = PJON_BROADCAST
     ) {
       PJON_Packet_Info info = fill_info(rx_id, header, packet_id, rx_port);
-      if(!(length = compose_packet(info, data, payload, length)))
-        return PJON_FAIL;
-      return send_packet(data, length);
+      return send_packet(info, payload, length);
     };
 
     uint16_t send_packet(
@@ -597,9 +939,8 @@ class PJON {
       const void *payload,
       uint16_t length
     ) {
-      if(!(length = compose_packet(info, data, payload, length)))
-        return PJON_FAIL;
-      return send_packet(data, length);
+      uint16_t result = transmit(info, payload, length);
+      return result ? result : PJON_FAIL;
     };
 
     /* Transmit a packet without using the packet's buffer. Tries to transmit
@@ -615,30 +956,43 @@ class PJON {
       uint16_t state = PJON_FAIL;
       uint32_t attempts = 0;
       uint32_t start = PJON_MICROS();
-      uint16_t old_length = length;
 
       _recursion++;
       while(
         (state != PJON_ACK) && (attempts <= strategy.get_max_attempts()) &&
         (uint32_t)(PJON_MICROS() - start) <= timeout
       ) {
-        if(!(length = compose_packet(packet_info, data, payload, old_length))) {
+        // Composed at each attempt, data may be used by receive
+        if(!(state = transmit(packet_info, payload, length))) {
           _recursion--;
           return PJON_FAIL;
         }
-        state = send_packet(data, length);
         if(state == PJON_ACK) {
+          #if(PJON_INCLUDE_STATS)
+            _stats.delivered(attempts + 1);
+          #endif
           _recursion--;
           return state;
         }
         attempts++;
-        if(state != PJON_FAIL) strategy.handle_collision();
+        if(state != PJON_FAIL) collision();
+        uint32_t back_off = PJON_Back_Off<Strategy>::compute(
+          strategy, attempts, packet_info.rx.id
+        );
+        #if(PJON_INCLUDE_STATS)
+          _stats.back_off_time += back_off;
+        #endif
+        PJON_TRACE_START(trace_start);
         #if(PJON_RECEIVE_WHILE_SENDING_BLOCKING)
-          if(_recursion <= 1) receive(strategy.back_off(attempts));
+          if(_recursion <= 1) receive(back_off);
           else
         #endif
-        PJON_DELAY((uint32_t)(strategy.back_off(attempts) / 1000));
+        PJON_DELAY((uint32_t)(back_off / 1000));
+        PJON_TRACE_STOP(PJON_TRACE_BACK_OFF, trace_start, 0);
       }
+      #if(PJON_INCLUDE_STATS)
+        _stats.lost++;
+      #endif
       _recursion--;
       return state;
     };
@@ -817,87 +1171,464 @@ class PJON {
       #endif
     };
 
+    /* Time to wait since registration before the next delivery attempt
+       (back off excluded), a packet waiting for its acknowledgement is
+       retransmitted after the strategy's response timeout: */
+
+    uint32_t attempt_interval(uint16_t i) {
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        if(packets[i].state == PJON_ACK_PENDING)
+          return PJON_Pipelined_Ack<Strategy>::response_timeout(strategy);
+      #endif
+      return packets[i].timing;
+    };
+
     /* Update the state of the send list:
        Checks if there are packets to be sent or to be erased if correctly
        delivered. Returns the actual number of packets to be sent. */
 
     uint16_t update() {
+      #if(PJON_INCLUDE_COROUTINES)
+        expire_replies();
+        uint16_t packets_count = update_packets();
+        resume_senders();
+        return packets_count;
+      #else
+        return update_packets();
+      #endif
+    };
+
+    /* Attempts the delivery of the packets that are due, returns the number
+       of packets to be sent: */
+
+    uint16_t update_packets() {
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        receive_acknowledges();
+      #endif
+      #if(PJON_INCLUDE_SCHEDULER)
+        return update_scheduled();
+      #endif
+      #if(PJON_INCLUDE_PRIORITY)
+        return update_prioritized();
+      #endif
       uint16_t packets_count = 0;
       for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
         if(packets[i].state == 0) continue;
         packets_count++;
+        if(due(i)) packets_count -= attempt(i);
+      }
+      return packets_count;
+    };
 
-        if(
-          (uint32_t)(PJON_MICROS() - packets[i].registration) >
-          (uint32_t)(
-            packets[i].timing +
-            strategy.back_off(packets[i].attempts)
-          )
-        ) {
-          if(packets[i].state != PJON_ACK)
-            packets[i].state =
-              send_packet(packets[i].content, packets[i].length);
-        } else continue;
+    /* Returns true if the next delivery attempt of a packet is due: */
 
-        packets[i].attempts++;
+    bool due(uint16_t i) {
+      uint32_t delay = back_off(i);
+      if(
+        (uint32_t)(PJON_MICROS() - packets[i].registration) <=
+        (uint32_t)(attempt_interval(i) + delay)
+      ) return false;
+      #if(PJON_INCLUDE_STATS)
+        packets[i].back_off = delay; // Counted by attempt as applied
+      #endif
+      return true;
+    };
 
-        if(packets[i].state == PJON_ACK) {
-          packets_count -= reset_packet(i);
-          continue;
-        }
+    /* Returns the back off of a packet, computed for its receiver: */
 
-        if(packets[i].state != PJON_FAIL && packets[i].state != PJON_ACK)
-          strategy.handle_collision();
+    uint32_t back_off(uint16_t i) {
+      return PJON_Back_Off<Strategy>::compute(
+        strategy, packets[i].attempts, packets[i].content[0]
+      );
+    };
 
-        if(packets[i].attempts > strategy.get_max_attempts()) {
-          _error(PJON_CONNECTION_LOST, i, _custom_pointer);
-          packets_count -= reset_packet(i);
+    /* Microseconds until the next delivery attempt is due, 0 if a packet is
+       already due, PJON_NO_ATTEMPT if the buffer is empty. Lets an event
+       loop sleep until update has something to do: */
+
+    uint32_t next_attempt() {
+      uint32_t now = PJON_MICROS();
+      uint32_t next = PJON_NO_ATTEMPT;
+      #if(PJON_INCLUDE_SCHEDULER)
+        if(_scheduler.top() != PJON_FAIL) {
+          uint64_t time = _scheduler.time(now);
+          uint64_t due = _scheduler.due[_scheduler.top()];
+          if(due < time) return 0;
+          next = (uint32_t)(due - time) + 1;
         }
+      #elif(PJON_INCLUDE_PRIORITY)
+        for(uint8_t c = 0; c < PJON_PRIORITY_CLASSES; c++) {
+          PJON_Receiver_Set retrying;
+          for(
+            uint16_t i = _queues.head[c];
+            i != PJON_FAIL;
+            i = _queues.next[i]
+          ) {
+            // Attempted after the older packet being retried
+            if(retrying.has(packets[i].content[0])) continue;
+            if(retried(i)) retrying.add(packets[i].content[0]);
+            if(!(next = wait(i, now, next))) return 0;
+          }
+        }
+      #else
+        for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
+          if(packets[i].state == 0) continue;
+          if(!(next = wait(i, now, next))) return 0;
+        }
+      #endif
+      #if(PJON_INCLUDE_COROUTINES)
+        // Replies awaited also expire in update
+        for(uint16_t r = 0; r < PJON_MAX_REPLY_AWAITERS; r++)
+          if(_replies[r] && _replies[r]->timeout) {
+            uint32_t elapsed = now - _replies[r]->start;
+            if(elapsed >= _replies[r]->timeout) return 0;
+            if(_replies[r]->timeout - elapsed < next)
+              next = _replies[r]->timeout - elapsed;
+          }
+      #endif
+      return next;
+    };
+
+    /* Returns the microseconds until the next delivery attempt of a packet
+       is due if less than next, 0 if it is already due: */
+
+    uint32_t wait(uint16_t i, uint32_t now, uint32_t next) {
+      uint32_t elapsed = now - packets[i].registration;
+      uint32_t wait = attempt_interval(i) + back_off(i);
+      if(elapsed > wait) return 0;
+      return (wait - elapsed + 1 < next) ? wait - elapsed + 1 : next;
+    };
+
+    /* Attempt the delivery of a packet, returns true if it is removed: */
+
+    bool attempt(uint16_t i) {
+      #if(PJON_INCLUDE_STATS && !PJON_INCLUDE_SCHEDULER)
+        // The back off waited before a retry, as evaluated by due
+        if(packets[i].attempts) _stats.back_off_time += packets[i].back_off;
+      #endif
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        if(pipelined(i)) return send_pipelined(i);
+      #endif
+      if(packets[i].state != PJON_ACK) {
+        PJON_TRACE_START(trace_start);
+        packets[i].state = send_packet(packets[i].content, packets[i].length);
+        PJON_TRACE_STOP(PJON_TRACE_ATTEMPT, trace_start, packets[i].length);
       }
-      return packets_count;
+      packets[i].attempts++;
+      if(packets[i].state == PJON_ACK) {
+        #if(PJON_INCLUDE_STATS)
+          _stats.delivered(packets[i].attempts);
+        #endif
+        return reset_packet(i);
+      }
+      if(packets[i].state != PJON_FAIL) collision();
+      if(packets[i].attempts > strategy.get_max_attempts()) {
+        #if(PJON_INCLUDE_STATS)
+          _stats.lost++;
+        #endif
+        _error(PJON_CONNECTION_LOST, i, _custom_pointer);
+        return reset_packet(i);
+      }
+      #if(PJON_INCLUDE_SCHEDULER)
+        // Computed once, the back off counted is the one applied
+        uint32_t delay = back_off(i);
+        #if(PJON_INCLUDE_STATS)
+          _stats.back_off_time += delay;
+        #endif
+        schedule(i, delay);
+      #endif
+      return false;
     };
 
+    #if(PJON_INCLUDE_SCHEDULER)
+
+      /* Schedule the next delivery attempt of a packet: */
+
+      void schedule(uint16_t i) {
+        schedule(i, back_off(i));
+      };
+
+      void schedule(uint16_t i, uint32_t back_off) {
+        if(packets[i].state == 0 || packets[i].state == PJON_ACK) {
+          _scheduler.unschedule(i);
+          return;
+        }
+        uint32_t now = PJON_MICROS();
+        _scheduler.schedule(
+          i,
+          _scheduler.time(now) - (uint32_t)(now - packets[i].registration) +
+          attempt_interval(i) + back_off
+        );
+      };
+
+      /* Same as update but visits only the packets that are due, each packet
+         is attempted at most once per call as in the linear scan: */
+
+      uint16_t update_scheduled() {
+        uint64_t now = _scheduler.time(PJON_MICROS());
+        uint16_t due_count = 0;
+        while(
+          (_scheduler.top() != PJON_FAIL) &&
+          (_scheduler.due[_scheduler.top()] < now)
+        ) {
+          _due[due_count++] = _scheduler.top();
+          _scheduler.unschedule(_scheduler.top());
+        }
+        for(uint16_t d = 0; d < due_count; d++) {
+          uint16_t i = _due[d];
+          // Skip packets removed or dispatched again by a callback
+          if(packets[i].state == 0 || _scheduler.scheduled(i)) continue;
+          if(!attempt(i) && !_scheduler.scheduled(i)) schedule(i);
+        }
+        return _scheduler.occupied();
+      };
+
+    #endif
+
+    #if(PJON_INCLUDE_PRIORITY)
+
+      /* Same as update but serves class 0 first and the other classes in
+         weighted round-robin. Within a class packets are visited in dispatch
+         order, a packet is skipped if an older packet to the same device is
+         still being retried (per-destination FIFO): */
+
+      uint16_t update_prioritized() {
+        uint16_t packets_count = 0;
+        for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
+          _ready[i] = packets[i].state && due(i);
+          if(packets[i].state) packets_count++;
+        }
+        for(uint8_t c = 0; c < PJON_PRIORITY_CLASSES; c++) {
+          uint16_t budget = c ? PJON_PRIORITY_WEIGHT(c) : PJON_MAX_PACKETS;
+          // Callbacks can change the queue, its order is copied first
+          uint16_t count = 0;
+          for(
+            uint16_t i = _queues.head[c];
+            i != PJON_FAIL;
+            i = _queues.next[i]
+          ) _order[count++] = i;
+          PJON_Receiver_Set retrying;
+          for(uint16_t o = 0; (o < count) && budget; o++) {
+            uint16_t i = _order[o];
+            // Skip packets removed or dispatched again by a callback
+            if(!packets[i].state) continue;
+            if(_ready[i] && !retrying.has(packets[i].content[0])) {
+              _ready[i] = false;
+              packets_count -= attempt(i);
+              budget--;
+            }
+            if(retried(i)) retrying.add(packets[i].content[0]);
+          }
+        }
+        return packets_count;
+      };
+
+      /* Returns true if a packet is waiting to be attempted again: */
+
+      bool retried(uint16_t i) const {
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          if(packets[i].state == PJON_ACK_PENDING) return false;
+        #endif
+        return
+          packets[i].state && packets[i].state != PJON_ACK &&
+          packets[i].attempts;
+      };
+
+      /* Priority class of a packet being dispatched, set by its info or
+         mapped from its port: */
+
+      uint8_t packet_priority(
+        const PJON_Packet_Info &info,
+        const uint8_t *packet
+      ) const {
+        if(info.priority < PJON_PRIORITY_CLASSES) return info.priority;
+        #if(PJON_INCLUDE_PORT)
+          if(packet[1] & PJON_PORT_BIT) {
+            PJON_Packet_Info composed;
+            Header::parse_header(packet, composed);
+            for(uint8_t p = 0; p < _priority_ports; p++)
+              if(_priority_port[p] == composed.port)
+                return _priority_class[p];
+          }
+        #else
+          (void)packet;
+        #endif
+        return PJON_DEFAULT_PRIORITY;
+      };
+
+      #if(PJON_INCLUDE_PORT)
+
+        /* Map a port to a priority class, the packets sent to the port are
+           dispatched with that class unless specified by their info.
+           Returns false if the table is full: */
+
+        bool set_port_priority(uint16_t p, uint8_t priority) {
+          if(priority >= PJON_PRIORITY_CLASSES) return false;
+          for(uint8_t i = 0; i < _priority_ports; i++)
+            if(_priority_port[i] == p) {
+              _priority_class[i] = priority;
+              return true;
+            }
+          if(_priority_ports == PJON_MAX_PRIORITY_PORTS) return false;
+          _priority_port[_priority_ports] = p;
+          _priority_class[_priority_ports++] = priority;
+          return true;
+        };
+
+      #endif
+
+    #endif
+
+    #if(PJON_INCLUDE_PIPELINED_ACK)
+
+      /* Set the maximum number of packets sent to the same device waiting
+         for their acknowledgement: */
+
+      void set_ack_window(uint8_t window) {
+        _ack_window = window ? window : 1;
+      };
+
+      /* Returns true if the packet is delivered in pipelined mode, it
+         requires a packet id and an acknowledgement request: */
+
+      bool pipelined(uint16_t i) const {
+        return
+          PJON_Pipelined_Ack<Strategy>::supported &&
+          (_mode != PJON_SIMPLEX) &&
+          (packets[i].content[0] != PJON_BROADCAST) &&
+          (packets[i].content[1] & PJON_ACK_REQ_BIT) &&
+          (packets[i].content[1] & PJON_PACKET_ID_BIT);
+      };
+
+      /* Get count of packets sent to a device waiting for acknowledgement: */
+
+      uint16_t get_packets_in_flight(uint8_t device_id) const {
+        return _in_flight[device_id];
+      };
+
+      /* Takes a packet waiting for its acknowledgement out of the count of
+         packets in flight of its receiver, called before its state changes
+         or its content is replaced: */
+
+      void land(uint16_t i) {
+        if(packets[i].state != PJON_ACK_PENDING) return;
+        _in_flight[packets[i].content[0]]--;
+        packets[i].state = PJON_TO_BE_SENT;
+      };
+
+      /* Transmit a packet without waiting for its acknowledgement, a packet
+         is retransmitted only if its acknowledgement is not received within
+         the strategy's response timeout. Returns true if removed: */
+
+      bool send_pipelined(uint16_t i) {
+        if(packets[i].state == PJON_ACK_PENDING) {
+          if(packets[i].attempts > strategy.get_max_attempts()) {
+            #if(PJON_INCLUDE_STATS)
+              _stats.lost++;
+            #endif
+            _error(PJON_CONNECTION_LOST, i, _custom_pointer);
+            return reset_packet(i);
+          }
+        } else if(
+          (packets[i].state == PJON_ACK) ||
+          (_in_flight[packets[i].content[0]] >= _ack_window)
+        ) return false;
+        if(!strategy.can_start()) {
+          busy();
+          return false;
+        }
+        PJON_TRACE_START(trace_start);
+        strategy.send_frame(packets[i].content, packets[i].length);
+        PJON_TRACE_STOP(PJON_TRACE_SEND_FRAME, trace_start, packets[i].length);
+        #if(PJON_INCLUDE_STATS)
+          _stats.transmitted(packets[i].length);
+        #endif
+        packets[i].attempts++;
+        if(packets[i].state != PJON_ACK_PENDING)
+          _in_flight[packets[i].content[0]]++;
+        packets[i].state = PJON_ACK_PENDING;
+        packets[i].registration = PJON_MICROS();
+        return false;
+      };
+
+      /* Match the acknowledgements received by the strategy with the
+         packets waiting for them: */
+
+      void receive_acknowledges() {
+        uint8_t device_id;
+        uint16_t packet_id;
+        while(
+          PJON_Pipelined_Ack<Strategy>::receive(strategy, device_id, packet_id)
+        )
+          for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++)
+            if(
+              packets[i].state == PJON_ACK_PENDING &&
+              packets[i].id == packet_id &&
+              packets[i].content[0] == device_id
+            ) {
+              #if(PJON_INCLUDE_STATS)
+                _stats.delivered(packets[i].attempts);
+              #endif
+              land(i);
+              packets[i].state = PJON_ACK;
+              reset_packet(i);
+              break;
+            }
+      };
+
+    #endif
+
     #if(PJON_INCLUDE_PACKET_ID)
 
       /* Checks if the packet id and its transmitter info are already present
          in the known packets buffer, if not add it to the buffer */
 
       bool known_packet_id(const PJON_Packet_Info &info) {
-        for(uint8_t i = 0; i < PJON_MAX_RECENT_PACKET_IDS; i++)
-          if(
-            info.id == recent_packet_ids[i].id &&
-            info.tx.id == recent_packet_ids[i].sender_id && (
-              (
-                (info.header & PJON_MODE_BIT) &&
-                (recent_packet_ids[i].header & PJON_MODE_BIT) &&
-                PJONTools::id_equality(
-                  (uint8_t *)info.tx.bus_id,
-                  (uint8_t *)recent_packet_ids[i].sender_bus_id,
-                  4
+        #if(PJON_INCLUDE_PACKET_ID_HASH)
+          if(recent_packet_ids.contains(info)) return true;
+          save_packet_id(info);
+          return false;
+        #else
+          for(uint16_t i = 0; i < PJON_MAX_RECENT_PACKET_IDS; i++)
+            if(
+              info.id == recent_packet_ids[i].id &&
+              info.tx.id == recent_packet_ids[i].sender_id && (
+                (
+                  (info.header & PJON_MODE_BIT) &&
+                  (recent_packet_ids[i].header & PJON_MODE_BIT) &&
+                  PJONTools::id_equality(
+                    (uint8_t *)info.tx.bus_id,
+                    (uint8_t *)recent_packet_ids[i].sender_bus_id,
+                    4
+                  )
+                ) || (
+                  !(info.header & PJON_MODE_BIT) &&
+                  !(recent_packet_ids[i].header & PJON_MODE_BIT)
                 )
-              ) || (
-                !(info.header & PJON_MODE_BIT) &&
-                !(recent_packet_ids[i].header & PJON_MODE_BIT)
               )
-            )
-          ) return true;
-        save_packet_id(info);
-        return false;
+            ) return true;
+          save_packet_id(info);
+          return false;
+        #endif
       };
 
       /* Save packet id in the buffer: */
 
       void save_packet_id(const PJON_Packet_Info &info) {
-        for(uint8_t i = PJON_MAX_RECENT_PACKET_IDS - 1; i > 0; i--)
-          recent_packet_ids[i] = recent_packet_ids[i - 1];
-        recent_packet_ids[0].id = info.id;
-        recent_packet_ids[0].header = info.header;
-        recent_packet_ids[0].sender_id = info.tx.id;
-        PJONTools::copy_id(
-          recent_packet_ids[0].sender_bus_id,
-          info.tx.bus_id,
-          4
-        );
+        #if(PJON_INCLUDE_PACKET_ID_HASH)
+          recent_packet_ids.insert(info);
+        #else
+          for(uint16_t i = PJON_MAX_RECENT_PACKET_IDS - 1; i > 0; i--)
+            recent_packet_ids[i] = recent_packet_ids[i - 1];
+          recent_packet_ids[0].id = info.id;
+          recent_packet_ids[0].header = info.header;
+          recent_packet_ids[0].sender_id = info.tx.id;
+          PJONTools::copy_id(
+            recent_packet_ids[0].sender_bus_id,
+            info.tx.bus_id,
+            4
+          );
+        #endif
       };
 
       /* Configure packet id presence:
@@ -924,13 +1655,301 @@ class PJON {
     #endif
 
   private:
+
+    #if(PJON_INCLUDE_COROUTINES)
+
+      /* Queue the coroutine awaiting the delivery of a packet, it is resumed
+         by resume_senders when the buffer is consistent again: */
+
+      void complete_sender(uint16_t i, uint16_t result) {
+        PJON_Send_Awaiter *awaiter = _senders[i];
+        if(!awaiter) return;
+        _senders[i] = NULL;
+        awaiter->result = result;
+        awaiter->next = NULL;
+        if(_completed_tail) _completed_tail->next = awaiter;
+        else _completed = awaiter;
+        _completed_tail = awaiter;
+      };
+
+      /* Resume the coroutines queued, in order of completion. A coroutine
+         may call update or remove, the nested call only queues and the
+         coroutines it completes are resumed by the outer loop: */
+
+      void resume_senders() {
+        if(_resuming) return;
+        _resuming = true;
+        while(_completed) {
+          PJON_Send_Awaiter *awaiter = _completed;
+          _completed = awaiter->next;
+          if(!_completed) _completed_tail = NULL;
+          awaiter->resume(); // May free the awaiter's frame
+        }
+        _resuming = false;
+      };
+
+      /* Resume the oldest coroutine awaiting the packet received, returns
+         false if there is none: */
+
+      bool resume_receiver(
+        uint8_t *payload,
+        uint16_t length,
+        const PJON_Packet_Info &info
+      ) {
+        for(uint16_t i = 0; i < PJON_MAX_REPLY_AWAITERS; i++)
+          if(_replies[i] && _replies[i]->matches(info)) {
+            PJON_Reply_Awaiter *awaiter = _replies[i];
+            _replies[i] = NULL;
+            awaiter->complete(PJON_ACK, payload, length, &info);
+            return true;
+          }
+        return false;
+      };
+
+      /* Resume the coroutines whose reply did not arrive in time: */
+
+      void expire_replies() {
+        uint32_t now = PJON_MICROS();
+        for(uint16_t i = 0; i < PJON_MAX_REPLY_AWAITERS; i++)
+          if(
+            _replies[i] && _replies[i]->timeout &&
+            (uint32_t)(now - _replies[i]->start) >= _replies[i]->timeout
+          ) {
+            PJON_Reply_Awaiter *awaiter = _replies[i];
+            _replies[i] = NULL;
+            awaiter->complete(PJON_FAIL);
+          }
+      };
+
+    #endif
+
+    /* Count a transmission not started, returns PJON_BUSY: */
+
+    uint16_t busy() {
+      #if(PJON_INCLUDE_STATS)
+        _stats.tx_busy++;
+      #endif
+      return PJON_BUSY;
+    };
+
+    /* Count a collision and let the strategy handle it: */
+
+    void collision() {
+      #if(PJON_INCLUDE_STATS)
+        _stats.collisions++;
+      #endif
+      strategy.handle_collision();
+    };
+
+    #if(PJON_INCLUDE_STATS)
+
+      /* Count the frames rejected by receive, a PJON_NAK is caused by the
+         header's CRC8 or by the CRC of the whole frame: */
+
+      void count_reception(uint16_t result) {
+        if(result == PJON_BUSY) _stats.rx_busy++;
+        if(result != PJON_NAK) return;
+        _stats.rx_naks++;
+        uint8_t crc_index = (data[1] & PJON_EXT_LEN_BIT) ? 4 : 3;
+        if(
+          (data[1] & PJON_CRC_BIT) &&
+          (PJON_crc8::compute(data, crc_index) == data[crc_index])
+        ) _stats.crc32_failures++;
+        else _stats.crc8_failures++;
+      };
+
+    #endif
+
+    /* Receive the response to a packet just transmitted if required: */
+
+    uint16_t response(const uint8_t *packet) {
+      if(
+        packet[0] == PJON_BROADCAST ||
+        !(packet[1] & PJON_ACK_REQ_BIT) ||
+        _mode == PJON_SIMPLEX
+      ) return PJON_ACK;
+      PJON_TRACE_START(trace_start);
+      uint16_t result = strategy.receive_response();
+      PJON_TRACE_STOP(PJON_TRACE_RECEIVE_RESPONSE, trace_start, 0);
+      return (result == PJON_ACK) ? PJON_ACK : PJON_FAIL;
+    };
+
+    /* Compose and transmit a packet, returns 0 if it can't be composed.
+       If the strategy supports it the payload is transmitted in place: */
+
+    uint16_t transmit(
+      const PJON_Packet_Info &info,
+      const void *payload,
+      uint16_t length
+    ) {
+      #if(PJON_INCLUDE_SCATTER_GATHER)
+        if(PJON_Scatter_Gather<Strategy>::supported) {
+          struct iovec frame[3];
+          if(!compose_frame(info, frame, payload, length)) return 0;
+          return send_frame(frame);
+        }
+      #endif
+      if(!(length = compose_packet(info, data, payload, length))) return 0;
+      return send_packet(data, length);
+    };
+
+    /* Length of the frame present in the buffer: */
+
+    uint16_t frame_length() const {
+      if(data[1] & PJON_EXT_LEN_BIT) return (data[2] << 8) | data[3];
+      return data[2];
+    };
+
+    /* Returns false if the header received must be rejected: */
+
+    bool acceptable_header(bool drop) const {
+      bool mac = data[1] & PJON_MAC_BIT;
+      return !(
+        (
+          !_router &&
+          ((config & PJON_MODE_BIT) && !(data[1] & PJON_MODE_BIT))
+        ) || (
+          (data[0] == PJON_BROADCAST) && (data[1] & PJON_ACK_REQ_BIT)
+        ) || (
+          (data[1] & PJON_EXT_LEN_BIT) && !(data[1] & PJON_CRC_BIT)
+        ) || (
+          !PJON_INCLUDE_PACKET_ID && (data[1] & PJON_PACKET_ID_BIT)
+        ) || (
+          !PJON_INCLUDE_PORT && (data[1] & PJON_PORT_BIT)
+        ) || (
+          (!PJON_INCLUDE_MAC && mac) || (mac && !(data[1] & PJON_CRC_BIT))
+        ) || (drop && !mac)
+      );
+    };
+
+    /* Returns false if the length received must be rejected: */
+
+    bool acceptable_length(uint16_t length, uint8_t overhead) const {
+      if(length < (uint8_t)(overhead + 1) || length >= PJON_PACKET_MAX_LENGTH)
+        return false;
+      return !(length > 15 && !(data[1] & PJON_CRC_BIT));
+    };
+
+    /* Handle a frame received and validated: */
+
+    uint16_t accept_frame(uint16_t length, uint8_t overhead, bool mac) {
+      #if(PJON_INCLUDE_STATS)
+        _stats.received(length);
+      #endif
+      #if(PJON_INCLUDE_MAC)
+        if(mac && (length > 15) && !_router)
+          if(!PJONTools::id_equality(data + (overhead - 16), tx.mac, 6))
+            if(!
+              PJONTools::id_equality(
+                data + (overhead - 16),
+                PJONTools::no_mac(), 6
+              )
+            ) return PJON_BUSY;
+      #else
+        (void)mac;
+      #endif
+
+      if(data[1] & PJON_ACK_REQ_BIT && data[0] != PJON_BROADCAST)
+        if((_mode != PJON_SIMPLEX) && !_router)
+          strategy.send_response(PJON_ACK);
+
+      parse(data, last_packet_info);
+
+      #if(PJON_INCLUDE_PACKET_ID)
+        if(
+          !_router &&
+          (last_packet_info.header & PJON_PACKET_ID_BIT) &&
+          known_packet_id(last_packet_info)
+        ) return PJON_ACK;
+      #endif
+
+      #if(PJON_INCLUDE_PORT)
+        if((port != PJON_BROADCAST) && (port != last_packet_info.port))
+          return PJON_BUSY;
+      #endif
+
+      #if(PJON_INCLUDE_COROUTINES)
+        if(resume_receiver(
+          data + (overhead - PJONTools::crc_overhead(data[1])),
+          length - overhead,
+          last_packet_info
+        )) return PJON_ACK;
+      #endif
+
+      PJON_TRACE_START(trace_start);
+      _receiver(
+        data + (overhead - PJONTools::crc_overhead(data[1])),
+        length - overhead,
+        last_packet_info
+      );
+      PJON_TRACE_STOP(PJON_TRACE_RECEIVER, trace_start, length - overhead);
+
+      return PJON_ACK;
+    };
+
+    /* Fold received bytes from crc_index up to end (CRC bytes excluded) in
+       the CRC32 or CRC8 selected by the header of the packet received: */
+
+    void crc_fold(
+      uint32_t &crc,
+      uint16_t &crc_index,
+      uint16_t end,
+      uint16_t length
+    ) {
+      uint16_t limit = length - PJONTools::crc_overhead(data[1]);
+      if(end > limit) end = limit;
+      if(end <= crc_index) return;
+      if(data[1] & PJON_CRC_BIT)
+        crc = PJON_crc32::compute(data + crc_index, end - crc_index, crc);
+      else crc = PJON_crc8::update(crc, data + crc_index, end - crc_index);
+      crc_index = end;
+    };
+
     bool          _auto_delete = true;
     void         *_custom_pointer;
     PJON_Error    _error;
     bool          _mode;
     uint16_t      _packet_id_seed = 0;
+    uint16_t      _packets_count = 0;
     uint8_t       _random_seed = A0;
     PJON_Receiver _receiver;
     uint8_t       _recursion = 0;
     bool          _router = false;
+
+    #if(PJON_INCLUDE_PIPELINED_ACK)
+      uint8_t _ack_window = PJON_ACK_WINDOW;
+      uint8_t _in_flight[256] = {}; // Packets waiting for ACK per device
+    #endif
+
+    #if(PJON_INCLUDE_PRIORITY)
+      bool     _ready[PJON_MAX_PACKETS];
+      uint16_t _order[PJON_MAX_PACKETS];
+      PJON_Priority_Queues<PJON_MAX_PACKETS, PJON_PRIORITY_CLASSES> _queues;
+      #if(PJON_INCLUDE_PORT)
+        uint16_t _priority_port[PJON_MAX_PRIORITY_PORTS];
+        uint8_t  _priority_class[PJON_MAX_PRIORITY_PORTS];
+        uint8_t  _priority_ports = 0;
+      #endif
+    #endif
+
+    #if(PJON_INCLUDE_SCHEDULER)
+      PJON_Scheduler<PJON_MAX_PACKETS> _scheduler;
+      uint16_t _due[PJON_MAX_PACKETS];
+    #endif
+
+    #if(PJON_INCLUDE_STATS)
+      PJON_Stats _stats;
+    #endif
+
+    #if(PJON_INCLUDE_TRACE)
+      uint8_t _trace_id = PJON_NOT_ASSIGNED;
+    #endif
+
+    #if(PJON_INCLUDE_COROUTINES)
+      PJON_Send_Awaiter  *_senders[PJON_MAX_PACKETS] = {NULL};
+      PJON_Send_Awaiter  *_completed = NULL;
+      PJON_Send_Awaiter  *_completed_tail = NULL;
+      bool                _resuming = false;
+      PJON_Reply_Awaiter *_replies[PJON_MAX_REPLY_AWAITERS] = {NULL};
+    #endif
 };
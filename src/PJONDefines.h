@@ -84,6 +84,8 @@ limitations under the License. */
 /* Internal constants: */
 #define PJON_FAIL                 65535
 #define PJON_TO_BE_SENT              74
+#define PJON_ACK_PENDING             75
+#define PJON_NO_ATTEMPT      0xFFFFFFFF
 
 /* Communication modes: */
 #define PJON_SIMPLEX              false
@@ -153,6 +155,31 @@ limitations under the License. */
 
 /* Optional features: */
 
+/* If defined packets carrying a packet id are transmitted by update without
+   waiting for their acknowledgement, which is later matched by packet id.
+   It requires a strategy able to receive acknowledgements out-of-band
+   (DualUDP or GlobalUDP) and includes the packet id feature */
+#ifdef PJON_INCLUDE_PIPELINED_ACK
+  #undef PJON_INCLUDE_PIPELINED_ACK
+  #define PJON_INCLUDE_PIPELINED_ACK   true
+  #ifndef PJON_INCLUDE_PACKET_ID
+    #define PJON_INCLUDE_PACKET_ID
+  #endif
+#else
+  #define PJON_INCLUDE_PIPELINED_ACK  false
+#endif
+
+/* Maximum number of packets sent to the same device waiting for their
+   acknowledgement (can be changed at runtime using set_ack_window) */
+#ifndef PJON_ACK_WINDOW
+  #define PJON_ACK_WINDOW             4
+#endif
+
+/* Number of acknowledgements a strategy can keep until update is called */
+#ifndef PJON_ACK_QUEUE_LENGTH
+  #define PJON_ACK_QUEUE_LENGTH PJON_MAX_PACKETS
+#endif
+
 /* If defined includes the packet id feature */
 #ifdef PJON_INCLUDE_PACKET_ID
   #undef PJON_INCLUDE_PACKET_ID
@@ -177,15 +204,180 @@ limitations under the License. */
   #define PJON_INCLUDE_MAC        false
 #endif
 
+/* If defined the packet buffer is scheduled using a min-heap ordered by
+   the time of the next delivery attempt and a stack of free slots */
+#ifdef PJON_INCLUDE_SCHEDULER
+  #undef PJON_INCLUDE_SCHEDULER
+  #define PJON_INCLUDE_SCHEDULER   true
+#else
+  #define PJON_INCLUDE_SCHEDULER  false
+#endif
+
+/* If defined the content of the packets present in the buffer is allocated
+   from an arena of PJON_PACKET_ARENA_LENGTH bytes using size classes,
+   instead of reserving PJON_PACKET_MAX_LENGTH bytes for each packet */
+#ifdef PJON_INCLUDE_PACKET_ARENA
+  #undef PJON_INCLUDE_PACKET_ARENA
+  #define PJON_INCLUDE_PACKET_ARENA   true
+#else
+  #define PJON_INCLUDE_PACKET_ARENA  false
+#endif
+
+#ifndef PJON_PACKET_ARENA_LENGTH
+  #define PJON_PACKET_ARENA_LENGTH (PJON_MAX_PACKETS * 64)
+#endif
+
+/* If defined the packet ids received are indexed with a hash table, so
+   PJON_MAX_RECENT_PACKET_IDS can be set up to thousands of records with a
+   constant cost per packet received */
+#ifdef PJON_INCLUDE_PACKET_ID_HASH
+  #undef PJON_INCLUDE_PACKET_ID_HASH
+  #define PJON_INCLUDE_PACKET_ID_HASH   true
+#else
+  #define PJON_INCLUDE_PACKET_ID_HASH  false
+#endif
+
+/* If defined update delivers the packets present in the buffer by priority
+   class: class 0 first (strict priority), the others in weighted round-robin
+   attempting up to PJON_PRIORITY_WEIGHT(class) packets per update call.
+   Packets sent to the same device with the same class are delivered in the
+   order they were dispatched (per-destination FIFO) */
+#ifdef PJON_INCLUDE_PRIORITY
+  #undef PJON_INCLUDE_PRIORITY
+  #define PJON_INCLUDE_PRIORITY   true
+#else
+  #define PJON_INCLUDE_PRIORITY  false
+#endif
+
+#if(PJON_INCLUDE_PRIORITY && PJON_INCLUDE_SCHEDULER)
+  #error "PJON_INCLUDE_PRIORITY is not compatible with PJON_INCLUDE_SCHEDULER"
+#endif
+
+/* Number of priority classes, 0 is the highest */
+#ifndef PJON_PRIORITY_CLASSES
+  #define PJON_PRIORITY_CLASSES       3
+#endif
+
+/* Class used if not specified by the packet info or by the port */
+#ifndef PJON_DEFAULT_PRIORITY
+  #define PJON_DEFAULT_PRIORITY       1
+#endif
+
+/* Packets of a class (except class 0) attempted in each update call */
+#ifndef PJON_PRIORITY_WEIGHT
+  #define PJON_PRIORITY_WEIGHT(c) (4 * (PJON_PRIORITY_CLASSES - (c)))
+#endif
+
+/* Maximum number of ports that can be mapped to a priority class */
+#ifndef PJON_MAX_PRIORITY_PORTS
+  #define PJON_MAX_PRIORITY_PORTS     4
+#endif
+
+#define PJON_NO_PRIORITY            255
+
+/* If defined send_packet and send_packet_blocking transmit the packet as a
+   list of segments (header, payload and CRC) if the strategy implements
+   send_frame_v, so the payload is not copied. It requires struct iovec */
+#ifdef PJON_INCLUDE_SCATTER_GATHER
+  #undef PJON_INCLUDE_SCATTER_GATHER
+  #define PJON_INCLUDE_SCATTER_GATHER   true
+  #include <sys/uio.h>
+#else
+  #define PJON_INCLUDE_SCATTER_GATHER  false
+#endif
+
+/* Maximum number of segments of a frame passed to send_frame_v */
+#ifndef PJON_MAX_FRAME_SEGMENTS
+  #define PJON_MAX_FRAME_SEGMENTS       4
+#endif
+
+/* If defined on Linux the UDP strategies receive up to PJON_UDP_BATCH_LENGTH
+   datagrams with a single recvmmsg call and GlobalUDP sends a broadcast to
+   up to PJON_UDP_BATCH_LENGTH nodes with a single sendmmsg call */
+#ifdef PJON_INCLUDE_UDP_BATCH
+  #undef PJON_INCLUDE_UDP_BATCH
+  #define PJON_INCLUDE_UDP_BATCH        true
+#else
+  #define PJON_INCLUDE_UDP_BATCH       false
+#endif
+
+#ifndef PJON_UDP_BATCH_LENGTH
+  #define PJON_UDP_BATCH_LENGTH        32
+#endif
+
+/* Frames received by GlobalUDP and DualUDP while waiting for an
+   acknowledgement are queued (up to PJON_UDP_INBOX_LENGTH, 0 to drop them)
+   and returned by the following receive_frame calls */
+#ifndef PJON_UDP_INBOX_LENGTH
+  #define PJON_UDP_INBOX_LENGTH         4
+#endif
+
+/* If defined each instance counts frames, bytes, failures, retries and the
+   packet buffer's high-water mark (see get_stats and reset_stats) */
+#ifdef PJON_INCLUDE_STATS
+  #undef PJON_INCLUDE_STATS
+  #define PJON_INCLUDE_STATS            true
+#else
+  #define PJON_INCLUDE_STATS           false
+#endif
+
+/* Length of the histogram of attempts per packet delivered */
+#ifndef PJON_STATS_ATTEMPTS
+  #define PJON_STATS_ATTEMPTS           8
+#endif
+
+/* If defined the duration of receive_frame, CRC validation, receiver
+   callback, send_frame, receive_response, back-off and delivery attempts
+   is recorded in a ring buffer that can be exported as a Chrome trace.
+   It requires std::atomic */
+#ifdef PJON_INCLUDE_TRACE
+  #undef PJON_INCLUDE_TRACE
+  #define PJON_INCLUDE_TRACE            true
+#else
+  #define PJON_INCLUDE_TRACE           false
+#endif
+
+/* Number of trace records kept (must be a power of 2) */
+#ifndef PJON_TRACE_LENGTH
+  #define PJON_TRACE_LENGTH          4096
+#endif
+
+/* If defined send_async and receive_async return awaitables, a coroutine
+   can wait for the delivery of a packet or for a reply. Requires C++20 */
+#ifdef PJON_INCLUDE_COROUTINES
+  #undef PJON_INCLUDE_COROUTINES
+  #define PJON_INCLUDE_COROUTINES       true
+#else
+  #define PJON_INCLUDE_COROUTINES      false
+#endif
+
+/* Maximum number of coroutines awaiting a reply at the same time */
+#ifndef PJON_MAX_REPLY_AWAITERS
+  #define PJON_MAX_REPLY_AWAITERS      PJON_MAX_PACKETS
+#endif
+
 /* Data structures: */
 
 struct PJON_Packet {
   uint8_t  attempts = 0;
-  uint8_t  content[PJON_PACKET_MAX_LENGTH];
+  #if(PJON_INCLUDE_PACKET_ARENA)
+    uint8_t *content = NULL;
+  #else
+    uint8_t  content[PJON_PACKET_MAX_LENGTH];
+  #endif
   uint16_t length;
   uint32_t registration;
   uint16_t state = 0;
   uint32_t timing = 0;
+  #if(PJON_INCLUDE_PIPELINED_ACK)
+    uint16_t id = 0;
+  #endif
+  #if(PJON_INCLUDE_PRIORITY)
+    uint8_t  priority = PJON_DEFAULT_PRIORITY;
+  #endif
+  #if(PJON_INCLUDE_STATS)
+    uint32_t back_off = 0; // Waited before the next attempt, if due
+  #endif
 };
 
 struct PJON_Packet_Record {
@@ -223,6 +415,9 @@ struct PJON_Packet_Info {
   #if(PJON_INCLUDE_PORT)
     uint16_t port = PJON_BROADCAST;
   #endif
+  #if(PJON_INCLUDE_PRIORITY)
+    uint8_t priority = PJON_NO_PRIORITY;
+  #endif
 };
 
 typedef void (* PJON_Receiver)(
@@ -256,7 +451,7 @@ struct PJONTools {
 
   /* Calculates the packet's overhead using the header: */
 
-  static uint8_t packet_overhead(uint8_t header) {
+  static constexpr uint8_t packet_overhead(uint8_t header) {
     return (
       (
         (header & PJON_MODE_BIT) ?
@@ -273,7 +468,7 @@ struct PJONTools {
 
   /* Calculates the packet's CRC overhead using the header: */
 
-  static uint8_t crc_overhead(uint8_t header) {
+  static constexpr uint8_t crc_overhead(uint8_t header) {
     return (header & PJON_CRC_BIT) ? 4 : 1;
   };
 
@@ -306,10 +501,29 @@ struct PJONTools {
   /* Composes a packet in PJON format: */
 
   static uint16_t compose_packet(
-    PJON_Packet_Info info,
+    const PJON_Packet_Info &info,
     uint8_t *destination,
     const void *source,
     uint16_t length
+  ) {
+    uint16_t new_length = compose_header(info, destination, length);
+    if(new_length >= PJON_PACKET_MAX_LENGTH) return new_length;
+    memcpy(
+      destination + new_length - length - crc_overhead(destination[1]),
+      source,
+      length
+    );
+    compose_crc(destination, new_length, destination[1]);
+    return new_length;
+  };
+
+  /* Composes the header of a packet having a payload of length bytes,
+     returns the length of the whole packet: */
+
+  static uint16_t compose_header(
+    PJON_Packet_Info info,
+    uint8_t *destination,
+    uint16_t length
   ) {
     uint8_t index = 0;
     if(length > 255) info.header |= PJON_EXT_LEN_BIT;
@@ -320,15 +534,15 @@ struct PJONTools {
     #endif
     if(info.rx.id == PJON_BROADCAST) info.header &= ~(PJON_ACK_REQ_BIT);
     uint16_t new_length = length + packet_overhead(info.header);
-    bool extended_length = info.header & PJON_EXT_LEN_BIT;
     if(new_length > 15 && !(info.header & PJON_CRC_BIT)) {
       info.header |= PJON_CRC_BIT;
       new_length = (uint16_t)(length + packet_overhead(info.header));
     }
-    if(new_length > 255 && !extended_length) {
+    if(new_length > 255 && !(info.header & PJON_EXT_LEN_BIT)) {
       info.header |= PJON_EXT_LEN_BIT;
       new_length = (uint16_t)(length + packet_overhead(info.header));
     }
+    bool extended_length = info.header & PJON_EXT_LEN_BIT;
     if(new_length >= PJON_PACKET_MAX_LENGTH) return new_length;
     destination[index++] = info.rx.id;
     destination[index++] = (uint8_t)info.header;
@@ -371,26 +585,50 @@ struct PJONTools {
         copy_id(&destination[index], info.rx.mac, 6);
         index += 6;
         copy_id(&destination[index], info.tx.mac, 6);
-        index += 6;
       }
     #endif
-    memcpy(destination + index, source, length);
-    if(info.header & PJON_CRC_BIT) {
-      uint32_t computed_crc =
-        PJON_crc32::compute((uint8_t *)destination, new_length - 4);
-      destination[new_length - 4] =
-        (uint8_t)((uint32_t)(computed_crc) >> 24);
-      destination[new_length - 3] =
-        (uint8_t)((uint32_t)(computed_crc) >> 16);
-      destination[new_length - 2] =
-        (uint8_t)((uint32_t)(computed_crc) >>  8);
-      destination[new_length - 1] =
-        (uint8_t)((uint32_t)computed_crc);
-    } else destination[new_length - 1] =
-      PJON_crc8::compute((uint8_t *)destination, new_length - 1);
     return new_length;
   };
 
+  /* Computes the CRC of a packet and writes it at its end: */
+
+  static void compose_crc(uint8_t *packet, uint16_t length, uint8_t header) {
+    if(header & PJON_CRC_BIT) {
+      uint32_t computed_crc = PJON_crc32::compute(packet, length - 4);
+      packet[length - 4] = (uint8_t)((uint32_t)(computed_crc) >> 24);
+      packet[length - 3] = (uint8_t)((uint32_t)(computed_crc) >> 16);
+      packet[length - 2] = (uint8_t)((uint32_t)(computed_crc) >>  8);
+      packet[length - 1] = (uint8_t)((uint32_t)computed_crc);
+    } else packet[length - 1] = PJON_crc8::compute(packet, length - 1);
+  };
+
+  /* Computes the CRC of a packet whose payload is not contiguous to its
+     header and writes it in destination: */
+
+  static void compose_crc(
+    uint8_t *destination,
+    const uint8_t *packet,
+    uint8_t header_length,
+    const void *payload,
+    uint16_t length
+  ) {
+    if(packet[1] & PJON_CRC_BIT) {
+      uint32_t computed_crc = PJON_crc32::compute(
+        (const uint8_t *)payload,
+        length,
+        PJON_crc32::compute(packet, header_length)
+      );
+      destination[0] = (uint8_t)((uint32_t)(computed_crc) >> 24);
+      destination[1] = (uint8_t)((uint32_t)(computed_crc) >> 16);
+      destination[2] = (uint8_t)((uint32_t)(computed_crc) >>  8);
+      destination[3] = (uint8_t)((uint32_t)computed_crc);
+    } else destination[0] = PJON_crc8::update(
+      PJON_crc8::compute(packet, header_length),
+      (const uint8_t *)payload,
+      length
+    );
+  };
+
   /* Fills a PJON_Packet_Info struct with data parsing a packet: */
 
   static void parse_header(const uint8_t *packet, PJON_Packet_Info &info) {
@@ -427,9 +665,11 @@ struct PJONTools {
       }
     #endif
     #if(PJON_INCLUDE_MAC)
-      copy_id(info.rx.mac, packet + index, 6);
-      index += 6;
-      copy_id(info.tx.mac, packet + index, 6);
+      if(info.header & PJON_MAC_BIT) {
+        copy_id(info.rx.mac, packet + index, 6);
+        index += 6;
+        copy_id(info.tx.mac, packet + index, 6);
+      }
     #endif
   };
 };
@@ -0,0 +1,240 @@
+
+ /*-O//\         __     __
+   |-gfo\       |__| | |  | |\ | ®
+   |!y°o:\      |  __| |__| | \| 13.1
+   |y"s§+`\     multi-master, multi-media bus network protocol
+  /so+:-..`\    Copyright 2010-2025 by Giovanni Blu Mitolo gioscarab@gmail.com
+  |+/:ngr-*.`\
+  |5/:%&-a3f.:;\
+  \+//u/+g%{osv,,\
+    \=+&/osw+olds.\\
+       \:/+-.-°-:+oss\
+        | |       \oy\\
+        > <
+ ______-| |-__________________________________________________________________
+PJONEventLoop drives any number of PJON instances on Linux from a single
+thread blocking on epoll instead of polling receive.
+
+Each instance's strategy can expose a file descriptor (see get_fd in
+utils/event/PJON_Descriptor.h), when it becomes readable, or while the
+strategy has buffered data pending, receive is called.
+A timerfd is armed for the earliest delivery attempt due in the instances'
+packet buffers (see PJON::next_attempt), when it expires update is called.
+Instances whose strategy has no descriptor are polled every
+PJON_EVENT_LOOP_POLL_TIME microseconds.
+
+PJONEventLoop loop;
+bus_a.begin();
+bus_b.begin();
+loop.add(bus_a);
+loop.add(bus_b);
+loop.run();   // Until stop is called (for example by a receiver function)
+ _____________________________________________________________________________
+
+This software is experimental and it is distributed "AS IS" without any
+warranty, use it at your own risk.
+
+Copyright 2010-2025 by Giovanni Blu Mitolo gioscarab@gmail.com
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+#include "PJON.h"
+#include "utils/event/PJON_Descriptor.h"
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifndef PJON_EVENT_LOOP_MAX_BUSES
+  #define PJON_EVENT_LOOP_MAX_BUSES   8
+#endif
+
+/* Polling interval of the instances without descriptor: */
+
+#ifndef PJON_EVENT_LOOP_POLL_TIME
+  #define PJON_EVENT_LOOP_POLL_TIME 1000 // Microseconds
+#endif
+
+class PJONEventLoop {
+public:
+  PJONEventLoop() {
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    _timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = PJON_EVENT_LOOP_MAX_BUSES;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, _timer, &event);
+  };
+
+  ~PJONEventLoop() {
+    if(_timer != -1) close(_timer);
+    if(_epoll != -1) close(_epoll);
+  };
+
+  /* Add an instance (already initialized with begin), returns false if
+     PJON_EVENT_LOOP_MAX_BUSES instances are already present: */
+
+  template<typename Strategy, typename Header>
+  bool add(PJON<Strategy, Header> &bus) {
+    if(_count >= PJON_EVENT_LOOP_MAX_BUSES) return false;
+    Source &source = _sources[_count++];
+    source.bus = &bus;
+    source.fd = -1;
+    source.polled = true;
+    source.get_fd = &get_fd<Strategy, Header>;
+    source.pending = &pending<Strategy, Header>;
+    source.update = &update<Strategy, Header>;
+    source.next_attempt = &next_attempt<Strategy, Header>;
+    source.receive = &receive<Strategy, Header>;
+    return true;
+  };
+
+  /* Call update, wait until a descriptor is readable, a delivery attempt is
+     due, or timeout milliseconds elapsed (-1 waits indefinitely), then call
+     receive on the instances ready. Returns the number of frames received: */
+
+  uint16_t run_once(int timeout = -1) {
+    uint32_t wait = PJON_NO_ATTEMPT;
+    for(uint8_t i = 0; i < _count; i++) {
+      Source &source = _sources[i];
+      source.update(source.bus);
+      uint32_t next = source.next_attempt(source.bus);
+      if(next < wait) wait = next;
+      watch(i);
+      source.ready = !source.polled && source.pending(source.bus);
+      if(source.ready) wait = 0;
+      if(source.polled && (_poll_time < wait)) wait = _poll_time;
+    }
+    if(!wait || _stop) timeout = 0; // Due or stop called by update
+    else arm(wait);
+    struct epoll_event events[PJON_EVENT_LOOP_MAX_BUSES + 1];
+    int count =
+      epoll_wait(_epoll, events, PJON_EVENT_LOOP_MAX_BUSES + 1, timeout);
+    uint16_t received = 0;
+    for(int e = 0; e < count; e++) {
+      uint32_t i = events[e].data.u32;
+      if(i == PJON_EVENT_LOOP_MAX_BUSES) {
+        uint64_t expirations;
+        if(read(_timer, &expirations, sizeof(expirations)) > 0)
+          _armed = false;
+      } else if(i < _count) _sources[i].ready = true;
+    }
+    for(uint8_t i = 0; i < _count; i++)
+      if(_sources[i].polled || _sources[i].ready)
+        if(_sources[i].receive(_sources[i].bus) != PJON_FAIL) received++;
+    return received;
+  };
+
+  /* Call run_once until stop is called (for example by a receiver or error
+     function): */
+
+  void run() {
+    _stop = false;
+    while(!_stop) run_once();
+  };
+
+  void stop() {
+    _stop = true;
+  };
+
+  /* Set the polling interval of the instances without descriptor: */
+
+  void set_poll_time(uint32_t time) {
+    _poll_time = time;
+  };
+
+private:
+  struct Source {
+    void *bus;
+    int fd;
+    bool polled; // No descriptor or descriptor not supported by epoll
+    bool ready;  // Descriptor readable or data pending in the strategy
+    int (*get_fd)(void *bus);
+    bool (*pending)(void *bus);
+    uint16_t (*update)(void *bus);
+    uint32_t (*next_attempt)(void *bus);
+    uint16_t (*receive)(void *bus);
+  };
+
+  Source   _sources[PJON_EVENT_LOOP_MAX_BUSES];
+  uint8_t  _count = 0;
+  int      _epoll = -1;
+  int      _timer = -1;
+  bool     _armed = false;
+  bool     _stop = false;
+  uint32_t _poll_time = PJON_EVENT_LOOP_POLL_TIME;
+
+  template<typename Strategy, typename Header>
+  static int get_fd(void *bus) {
+    return PJON_Descriptor<Strategy>::get(
+      ((PJON<Strategy, Header> *)bus)->strategy
+    );
+  };
+
+  template<typename Strategy, typename Header>
+  static bool pending(void *bus) {
+    return PJON_Pending<Strategy>::get(
+      ((PJON<Strategy, Header> *)bus)->strategy
+    );
+  };
+
+  template<typename Strategy, typename Header>
+  static uint16_t update(void *bus) {
+    return ((PJON<Strategy, Header> *)bus)->update();
+  };
+
+  template<typename Strategy, typename Header>
+  static uint32_t next_attempt(void *bus) {
+    return ((PJON<Strategy, Header> *)bus)->next_attempt();
+  };
+
+  template<typename Strategy, typename Header>
+  static uint16_t receive(void *bus) {
+    return ((PJON<Strategy, Header> *)bus)->receive();
+  };
+
+  /* Register the current descriptor of a source if it changed: */
+
+  void watch(uint8_t i) {
+    Source &source = _sources[i];
+    int fd = source.get_fd(source.bus);
+    if(fd == source.fd) return;
+    if(source.fd != -1 && !source.polled)
+      epoll_ctl(_epoll, EPOLL_CTL_DEL, source.fd, NULL);
+    source.fd = fd;
+    source.polled = true;
+    if(fd == -1) return;
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = i;
+    if(
+      (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) == 0) ||
+      ((errno == EEXIST) && !epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &event))
+    ) source.polled = false;
+  };
+
+  /* Arm the timer to expire in time microseconds, disarm it if time is
+     PJON_NO_ATTEMPT: */
+
+  void arm(uint32_t time) {
+    if(time == PJON_NO_ATTEMPT && !_armed) return;
+    struct itimerspec spec = {{0, 0}, {0, 0}};
+    if(time != PJON_NO_ATTEMPT) {
+      spec.it_value.tv_sec = time / 1000000;
+      spec.it_value.tv_nsec = (time % 1000000) * 1000;
+    }
+    timerfd_settime(_timer, 0, &spec, NULL);
+    _armed = (time != PJON_NO_ATTEMPT);
+  };
+};
@@ -0,0 +1,299 @@
+
+ /*-O//\         __     __
+   |-gfo\       |__| | |  | |\ | ®
+   |!y°o:\      |  __| |__| | \| 13.1
+   |y"s§+`\     multi-master, multi-media bus network protocol
+  /so+:-..`\    Copyright 2010-2025 by Giovanni Blu Mitolo gioscarab@gmail.com
+  |+/:ngr-*.`\
+  |5/:%&-a3f.:;\
+  \+//u/+g%{osv,,\
+    \=+&/osw+olds.\\
+       \:/+-.-°-:+oss\
+        | |       \oy\\
+        > <
+ ______-| |-__________________________________________________________________
+PJONThreaded runs a PJON instance on a dedicated thread (Linux only).
+
+PJON is not thread-safe, PJONThreaded owns the instance and is the only
+one calling dispatch, update and receive. The other threads can call send
+concurrently: packets are copied in a lock-free multi-producer ring that
+the bus thread drains into dispatch. Received packets are copied in a
+lock-free single-producer single-consumer ring drained calling receive
+from a single consumer thread, or are passed to a receiver function called
+by the bus thread if set_receiver is used.
+
+PJONThreaded<DualUDP> node(44);
+node.bus.set_crc_32(true);   // Configure the bus before start
+node.start();                // Calls bus.begin and starts the thread
+node.send(45, "B", 1);       // From any thread
+PJON_Threaded_Packet packet;
+if(node.receive(packet)) { } // From one thread
+node.stop();
+ _____________________________________________________________________________
+
+This software is experimental and it is distributed "AS IS" without any
+warranty, use it at your own risk.
+
+Copyright 2010-2025 by Giovanni Blu Mitolo gioscarab@gmail.com
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+#include "PJON.h"
+#include "utils/threaded/PJON_Ring.h"
+#include <thread>
+
+#ifndef PJON_THREADED_SEND_QUEUE
+  #define PJON_THREADED_SEND_QUEUE    64 // Must be 2^n
+#endif
+
+#ifndef PJON_THREADED_RECEIVE_QUEUE
+  #define PJON_THREADED_RECEIVE_QUEUE 64 // Must be 2^n
+#endif
+
+/* Time slept by the bus thread if an iteration does nothing: */
+
+#ifndef PJON_THREADED_IDLE_TIME
+  #define PJON_THREADED_IDLE_TIME     50 // Microseconds
+#endif
+
+struct PJON_Threaded_Packet {
+  PJON_Packet_Info info;
+  uint16_t length;
+  uint8_t  payload[PJON_PACKET_MAX_LENGTH];
+};
+
+/* Entry of the send queue, if filled is false the info is composed by the
+   bus thread from rx_id, header, packet_id and rx_port: */
+
+struct PJON_Threaded_Send : public PJON_Threaded_Packet {
+  bool     filled;
+  uint8_t  rx_id;
+  uint8_t  header;
+  uint16_t packet_id;
+  uint16_t rx_port;
+};
+
+template<typename Strategy, typename Header = PJON_Dynamic_Header>
+class PJONThreaded {
+public:
+  /* The instance, it can be used only before start and after stop: */
+  PJON<Strategy, Header> bus;
+
+  PJONThreaded() : bus() { };
+
+  PJONThreaded(uint8_t device_id) : bus(device_id) { };
+
+  PJONThreaded(const uint8_t *bus_id, uint8_t device_id) :
+    bus(bus_id, device_id) { };
+
+  ~PJONThreaded() {
+    stop();
+  };
+
+  /* Call bus.begin and start the bus thread: */
+
+  void start() {
+    if(_running.load()) return;
+    bus.set_custom_pointer(this);
+    bus.set_receiver(receiver_function);
+    bus.set_error(error_function);
+    bus.begin();
+    _running.store(true);
+    _thread = std::thread(&PJONThreaded::loop, this);
+  };
+
+  /* Stop the bus thread, the packets still in the send queue are kept: */
+
+  void stop() {
+    if(!_running.load()) return;
+    _running.store(false);
+    _thread.join();
+  };
+
+  bool running() const {
+    return _running.load(std::memory_order_relaxed);
+  };
+
+  /* Schedule a packet sending (thread-safe), returns false if the send
+     queue is full or the payload does not fit PJON_PACKET_MAX_LENGTH: */
+
+  bool send(
+    uint8_t rx_id,
+    const void *payload,
+    uint16_t length,
+    uint8_t  header = PJON_NO_HEADER,
+    uint16_t packet_id = 0,
+    uint16_t rx_port = PJON_BROADCAST
+  ) {
+    // fill_info reads the bus id, it is called by the bus thread
+    if(length > PJON_PACKET_MAX_LENGTH) return false;
+    return _outgoing.push([&](PJON_Threaded_Send &packet) {
+      packet.filled = false;
+      packet.rx_id = rx_id;
+      packet.header = header;
+      packet.packet_id = packet_id;
+      packet.rx_port = rx_port;
+      packet.length = length;
+      memcpy(packet.payload, payload, length);
+    });
+  };
+
+  bool send(
+    const PJON_Packet_Info &info,
+    const void *payload,
+    uint16_t length
+  ) {
+    if(length > PJON_PACKET_MAX_LENGTH) return false;
+    return _outgoing.push([&](PJON_Threaded_Send &packet) {
+      packet.filled = true;
+      packet.info = info;
+      packet.length = length;
+      memcpy(packet.payload, payload, length);
+    });
+  };
+
+  /* Copy the oldest packet received, returns false if there is none
+     (call it from a single thread, not used if set_receiver is used): */
+
+  bool receive(PJON_Threaded_Packet &packet) {
+    PJON_Threaded_Packet *received = _incoming.front();
+    if(!received) return false;
+    packet.info = received->info;
+    packet.length = received->length;
+    memcpy(packet.payload, received->payload, received->length);
+    _incoming.pop();
+    return true;
+  };
+
+  /* Pass a receiver function called by the bus thread (packets are not
+     queued), or NULL to queue the packets for receive: */
+
+  void set_receiver(PJON_Receiver r) {
+    _receiver = r;
+  };
+
+  /* Pass an error function called by the bus thread: */
+
+  void set_error(PJON_Error e) {
+    _error = e;
+  };
+
+  /* Custom pointer passed to the receiver and error functions: */
+
+  void set_custom_pointer(void *pointer) {
+    _custom_pointer = pointer;
+  };
+
+  /* Set the time slept by the bus thread if an iteration does nothing.
+     On Linux the sleep lasts 50-100us more than requested (the oversleep
+     of the system) and uses almost no CPU time. 0 only yields: the latency
+     is lower but the bus thread keeps a core busy: */
+
+  void set_idle_time(uint32_t time) {
+    _idle_time.store(time, std::memory_order_relaxed);
+  };
+
+  /* Packets received and dropped because the receive queue was full: */
+
+  uint32_t get_dropped_packets() const {
+    return _dropped.load(std::memory_order_relaxed);
+  };
+
+private:
+  PJON_MPSC_Ring<PJON_Threaded_Send, PJON_THREADED_SEND_QUEUE> _outgoing;
+  PJON_SPSC_Ring<PJON_Threaded_Packet, PJON_THREADED_RECEIVE_QUEUE> _incoming;
+  std::thread             _thread;
+  std::atomic<bool>       _running{false};
+  std::atomic<uint32_t>   _idle_time{PJON_THREADED_IDLE_TIME};
+  std::atomic<uint32_t>   _dropped{0};
+  PJON_Receiver           _receiver = NULL;
+  PJON_Error              _error = NULL;
+  void                   *_custom_pointer = NULL;
+  bool                    _dispatching = false; // Used by the bus thread
+  bool                    _full = false;
+
+  /* Move the queued packets in the packets buffer, returns the number of
+     packets moved. A packet stays queued while the buffer (or the packet
+     arena) is full, a packet that can't be composed is dropped and reported
+     to the error function: */
+
+  uint16_t dispatch_queued() {
+    uint16_t count = 0;
+    PJON_Threaded_Send *packet;
+    while((packet = _outgoing.front())) {
+      if(!packet->filled) {
+        packet->info = bus.fill_info(
+          packet->rx_id,
+          packet->header,
+          packet->packet_id,
+          packet->rx_port
+        );
+        packet->filled = true;
+      }
+      _full = false;
+      _dispatching = true;
+      uint16_t result =
+        bus.dispatch(packet->info, packet->payload, packet->length);
+      _dispatching = false;
+      if(_full) break; // Dispatched again at the next iteration
+      _outgoing.pop();
+      if(result != PJON_FAIL) count++;
+    }
+    return count;
+  };
+
+  void loop() {
+    while(_running.load(std::memory_order_acquire)) {
+      bool idle = !dispatch_queued();
+      bus.update();
+      if(bus.receive() != PJON_FAIL) idle = false;
+      uint32_t idle_time = _idle_time.load(std::memory_order_relaxed);
+      if(!idle) continue;
+      if(idle_time) PJON_DELAY_MICROSECONDS(idle_time);
+      else std::this_thread::yield();
+    }
+  };
+
+  static void receiver_function(
+    uint8_t *payload,
+    uint16_t length,
+    const PJON_Packet_Info &packet_info
+  ) {
+    PJONThreaded *self = (PJONThreaded *)packet_info.custom_pointer;
+    PJON_Packet_Info info = packet_info;
+    info.custom_pointer = self->_custom_pointer;
+    if(self->_receiver) {
+      self->_receiver(payload, length, info);
+      return;
+    }
+    PJON_Threaded_Packet *packet = self->_incoming.back();
+    if(!packet) {
+      self->_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    packet->info = info;
+    packet->length = length;
+    memcpy(packet->payload, payload, length);
+    self->_incoming.push();
+  };
+
+  static void error_function(uint8_t code, uint16_t data, void *pointer) {
+    PJONThreaded *self = (PJONThreaded *)pointer;
+    if(self->_dispatching && (code == PJON_PACKETS_BUFFER_FULL)) {
+      self->_full = true; // Not lost, the packet stays queued
+      return;
+    }
+    if(self->_error) self->_error(code, data, self->_custom_pointer);
+  };
+};
@@ -58,6 +58,20 @@ extern "C" {
 
   void delay(uint32_t delay_value_ms);
 
+  void PJON_LINUX_precise_delay(uint32_t delay_value);
+
+  /* Minimum and maximum time in microseconds spent spinning at the end of
+     PJON_LINUX_precise_delay (see PJON_LINUX_spin_delay), define
+     PJON_LINUX_SLEEP_DELAY to only sleep */
+
+  #ifndef PJON_LINUX_SPIN_MARGIN
+    #define PJON_LINUX_SPIN_MARGIN 20
+  #endif
+
+  #ifndef PJON_LINUX_SPIN_MARGIN_MAX
+    #define PJON_LINUX_SPIN_MARGIN_MAX 80
+  #endif
+
   /* Open serial port ----------------------------------------------------- */
 
   int serialOpen(const char *device, const int baud);
@@ -150,6 +164,10 @@ extern "C" {
     #define PJON_DELAY_MICROSECONDS delayMicroseconds
   #endif
 
+  #ifndef PJON_DELAY_MICROSECONDS_PRECISE
+    #define PJON_DELAY_MICROSECONDS_PRECISE PJON_LINUX_precise_delay
+  #endif
+
   #ifndef PJON_MICROS
     #define PJON_MICROS micros
   #endif
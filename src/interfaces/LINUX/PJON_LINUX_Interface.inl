@@ -9,53 +9,179 @@
 #include "/usr/include/asm-generic/termbits.h"
 #include "/usr/include/asm-generic/ioctls.h"
 #include <chrono>
+#include <atomic>
+#include <time.h>
+#include <errno.h>
+
+/* Time ----------------------------------------------------------------- */
+
+/* micros and millis are read from CLOCK_MONOTONIC (not affected by changes
+   of the system time), they share the same epoch (the first reading) and
+   wrap around at 2^32 like on the other platforms, so the elapsed time
+   (uint32_t)(PJON_MICROS() - start) is correct also across the overflow.
+
+   If PJON_Virtual_Clock is started micros and millis return its time
+   instead. The virtual time advances only when advance is called, when
+   delay or delayMicroseconds are called (without sleeping) and by step
+   microseconds at each reading (polling loops waiting for a timeout end),
+   so a test harness can run timeouts and back-offs faster than real time:
+
+   PJON_Virtual_Clock::start(0xFFFF0000); // Overflows after 65ms
+   bus.send(44, "B", 1);
+   while(bus.update()) {
+     bus.receive();
+     PJON_Virtual_Clock::advance(1000);
+   }
+   PJON_Virtual_Clock::stop(); */
+
+inline uint64_t PJON_LINUX_monotonic_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+};
+
+inline uint64_t PJON_LINUX_monotonic() {
+  return PJON_LINUX_monotonic_ns() / 1000;
+};
 
-inline auto& getMutableStartTime()
-{
-    static auto start_ts = std::chrono::high_resolution_clock::now();
-    return start_ts;
-}
-inline auto getStartTime()
-{
-    static auto start_ts_ms = std::chrono::high_resolution_clock::now();
-    return start_ts_ms;
-}
+struct PJON_Virtual_Clock {
+  struct State {
+    std::atomic<bool> running;
+    std::atomic<uint64_t> time;
+    std::atomic<uint32_t> step;
+    State() : running(false), time(0), step(0) { };
+  };
+
+  static State &state() {
+    static State s;
+    return s;
+  };
+
+  /* Starts the virtual clock at time microseconds, each reading advances
+     it by step microseconds: */
+
+  static void start(uint64_t time = 0, uint32_t step = 0) {
+    state().time.store(time);
+    state().step.store(step);
+    state().running.store(true, std::memory_order_release);
+  };
+
+  static void stop() {
+    state().running.store(false, std::memory_order_release);
+  };
+
+  static bool running() {
+    return state().running.load(std::memory_order_acquire);
+  };
+
+  static void advance(uint64_t microseconds) {
+    state().time.fetch_add(microseconds);
+  };
+
+  static uint64_t read() {
+    return state().time.fetch_add(
+      state().step.load(std::memory_order_relaxed)
+    );
+  };
+};
+
+/* Microseconds elapsed since the epoch (64 bits, never wraps around): */
+
+inline uint64_t PJON_LINUX_time() {
+  static const uint64_t epoch = PJON_LINUX_monotonic();
+  if(PJON_Virtual_Clock::running()) return PJON_Virtual_Clock::read();
+  return PJON_LINUX_monotonic() - epoch;
+};
 
 inline uint32_t micros() {
-  auto elapsed_usec =
-  std::chrono::duration_cast<std::chrono::microseconds>(
-    std::chrono::high_resolution_clock::now() - getMutableStartTime()
-  ).count();
-
-  if(elapsed_usec >= UINT32_MAX) {
-    getMutableStartTime() = std::chrono::high_resolution_clock::now();
-    return 0;
-  } else return elapsed_usec;
+  return (uint32_t)PJON_LINUX_time();
 };
 
 inline uint32_t millis() {
-  return (uint32_t)
-  std::chrono::duration_cast<std::chrono::milliseconds>(
-    std::chrono::high_resolution_clock::now() - getStartTime()
-  ).count();
+  return (uint32_t)(PJON_LINUX_time() / 1000);
+};
+
+/* Delays --------------------------------------------------------------- */
+
+/* delay and delayMicroseconds sleep with clock_nanosleep until an absolute
+   time, they end later by the oversleep of the system (50-100us) but don't
+   use CPU time while waiting.
+
+   PJON_LINUX_precise_delay (PJON_DELAY_MICROSECONDS_PRECISE) is used only
+   where sub-tick precision is required: it sleeps until the end of the delay
+   minus a margin and then spins on the monotonic clock until the end.
+   The margin is calibrated with the oversleep measured at each delay: it
+   grows by 16us if the oversleep is higher and decreases by 1us otherwise,
+   converging to the 94th percentile of the oversleep of the system (not
+   affected by rare long preemptions) between PJON_LINUX_SPIN_MARGIN and
+   PJON_LINUX_SPIN_MARGIN_MAX microseconds. Delays shorter than the margin
+   only spin, using a core for their whole duration.
+
+   If PJON_LINUX_SLEEP_DELAY is defined the precise delay only sleeps. */
+
+inline std::atomic<uint32_t> &PJON_LINUX_spin_margin() {
+  static std::atomic<uint32_t> margin(PJON_LINUX_SPIN_MARGIN);
+  return margin;
+};
+
+/* Sleeps until time, in nanoseconds of CLOCK_MONOTONIC: */
+
+inline void PJON_LINUX_sleep_until(uint64_t time) {
+  struct timespec until;
+  until.tv_sec = time / 1000000000;
+  until.tv_nsec = time % 1000000000;
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+};
+
+/* Waits duration microseconds sleeping and then spinning: */
+
+inline void PJON_LINUX_spin_delay(uint64_t duration) {
+  uint64_t end = PJON_LINUX_monotonic_ns() + (duration * 1000);
+  #ifdef PJON_LINUX_SLEEP_DELAY
+    PJON_LINUX_sleep_until(end);
+  #else
+    uint32_t margin = PJON_LINUX_spin_margin().load(std::memory_order_relaxed);
+    if(duration > margin) {
+      uint64_t wake = end - ((uint64_t)margin * 1000);
+      PJON_LINUX_sleep_until(wake);
+      if(PJON_LINUX_monotonic_ns() - wake > (uint64_t)margin * 1000) {
+        if(margin + 16 <= PJON_LINUX_SPIN_MARGIN_MAX) margin += 16;
+      } else if(margin > PJON_LINUX_SPIN_MARGIN) margin--;
+      PJON_LINUX_spin_margin().store(margin, std::memory_order_relaxed);
+    }
+    while(PJON_LINUX_monotonic_ns() < end);
+  #endif
 };
 
 inline void delayMicroseconds(uint32_t delay_value) {
-  struct timeval tv;
-  if (delay_value < 1000000){
-    tv.tv_sec = 0;
-    tv.tv_usec = delay_value;
-  }
-  else{
-    tv.tv_sec = floor(delay_value / 1000000);
-    tv.tv_usec = delay_value - tv.tv_sec * 1000000;
+  if(PJON_Virtual_Clock::running()) {
+    PJON_Virtual_Clock::advance(delay_value);
+    std::this_thread::yield();
+    return;
   }
+  PJON_LINUX_sleep_until(
+    PJON_LINUX_monotonic_ns() + ((uint64_t)delay_value * 1000)
+  );
+};
 
-  select(0, NULL, NULL, NULL, &tv);
+inline void PJON_LINUX_precise_delay(uint32_t delay_value) {
+  if(PJON_Virtual_Clock::running()) {
+    PJON_Virtual_Clock::advance(delay_value);
+    std::this_thread::yield();
+    return;
+  }
+  PJON_LINUX_spin_delay(delay_value);
 };
 
 inline void delay(uint32_t delay_value_ms) {
-  std::this_thread::sleep_for(std::chrono::milliseconds(delay_value_ms));
+  if(PJON_Virtual_Clock::running()) {
+    PJON_Virtual_Clock::advance((uint64_t)delay_value_ms * 1000);
+    std::this_thread::yield();
+    return;
+  }
+  PJON_LINUX_sleep_until(
+    PJON_LINUX_monotonic_ns() + ((uint64_t)delay_value_ms * 1000000)
+  );
 };
 
 /* Open serial port ----------------------------------------------------- */
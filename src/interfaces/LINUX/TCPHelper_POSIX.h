@@ -215,6 +215,8 @@ public:
 
   bool connected() { return _fd != -1; }
 
+  int get_fd() const { return (int)_fd; }
+
   int read(uint8_t *buffer, int buffer_size) {
     if (_fd == -1) return -1;
     int r = ::recv(_fd, (char*)buffer, buffer_size, 0); //MSG_DONTWAIT);
@@ -257,6 +259,25 @@ public:
     return w;
   }
 
+#if(PJON_INCLUDE_SCATTER_GATHER)
+  // Write count segments with a single system call
+  int write_v(const struct iovec *segments, int count) {
+    if (_fd == -1) return -1;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = (struct iovec *)segments;
+    message.msg_iovlen = count;
+    int w = ::sendmsg(_fd, &message, MSG_NOSIGNAL);
+    if (w == -1) {
+      #ifdef ETCP_ERROR_PRINT
+      if (errno != EPIPE) printf("write triggered stop, w=%d: %s\n", w, strerror(errno));
+      #endif
+      stop();
+    }
+    return w;
+  }
+#endif
+
   void flush() { }
 
   void stop() {
@@ -298,6 +319,8 @@ public:
     stop();
   }
 
+  int get_fd() const { return _fd; }
+
   TCPHelperClient available() {
     socklen_t len = sizeof(_remote_sender_addr);
     memset(&_remote_sender_addr, 0, len);
@@ -29,6 +29,56 @@ class UDPHelper {
   uint32_t _magic_header;
   sockaddr_in _localaddr, _remote_receiver_addr, _remote_sender_addr;
   int _fd = -1;
+
+#if(PJON_INCLUDE_UDP_BATCH) && !defined(_WIN32) && !defined(__ZEPHYR__)
+  /* Datagrams received with the last recvmmsg, consumed by receive_frame: */
+
+  struct Datagram {
+    uint32_t header;
+    uint8_t  frame[PJON_PACKET_MAX_LENGTH];
+    sockaddr_in sender;
+    uint16_t length; // 0 if not valid
+  };
+
+  Datagram _batch[PJON_UDP_BATCH_LENGTH];
+  uint16_t _batch_position = 0;
+  uint16_t _batch_count = 0;
+
+  bool receive_batch() {
+    struct mmsghdr messages[PJON_UDP_BATCH_LENGTH];
+    struct iovec segments[PJON_UDP_BATCH_LENGTH][2];
+    memset(messages, 0, sizeof(messages));
+    for(uint16_t i = 0; i < PJON_UDP_BATCH_LENGTH; i++) {
+      segments[i][0].iov_base = &_batch[i].header;
+      segments[i][0].iov_len = 4;
+      segments[i][1].iov_base = _batch[i].frame;
+      segments[i][1].iov_len = PJON_PACKET_MAX_LENGTH;
+      messages[i].msg_hdr.msg_name = &_batch[i].sender;
+      messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      messages[i].msg_hdr.msg_iov = segments[i];
+      messages[i].msg_hdr.msg_iovlen = 2;
+    }
+    _batch_position = _batch_count = 0;
+    // Waits (up to the receive timeout) only for the first datagram
+    int count = recvmmsg(
+      _fd,
+      messages,
+      PJON_UDP_BATCH_LENGTH,
+      MSG_WAITFORONE,
+      NULL
+    );
+    if(count <= 0) return false;
+    for(uint16_t i = 0; i < count; i++)
+      _batch[i].length = (
+        (messages[i].msg_len > 4) &&
+        !(messages[i].msg_hdr.msg_flags & MSG_TRUNC) &&
+        (_batch[i].header == _magic_header)
+      ) ? messages[i].msg_len - 4 : 0;
+    _batch_count = count;
+    return true;
+  }
+#endif
+
 public:
   ~UDPHelper() {
     if (_fd != -1)
@@ -109,6 +159,9 @@ public:
     return true;
   }
 
+  int get_fd() const { return _fd; }
+
+#if defined(_WIN32) || defined(__ZEPHYR__)
   uint16_t receive_frame(uint8_t *string, uint16_t max_length) {
     struct sockaddr_storage src_addr;
     socklen_t src_addr_len=sizeof(src_addr);
@@ -159,6 +212,168 @@ public:
       //printf("send_frame %d sendto %d\n", length, res);
     }
   }
+#else
+#if(PJON_INCLUDE_UDP_BATCH)
+  /* Returns the next datagram of the batch, receives a batch if none: */
+
+  uint16_t receive_frame(uint8_t *string, uint16_t max_length) {
+    if(_batch_position == _batch_count)
+      if(!receive_batch()) return false; // Reception failed
+    Datagram &datagram = _batch[_batch_position++];
+    if(!datagram.length || (datagram.length > max_length)) return false;
+    memcpy(string, datagram.frame, datagram.length);
+    // Remember sender's address
+    memcpy(&_remote_sender_addr, &datagram.sender, sizeof(_remote_sender_addr));
+    return datagram.length;
+  }
+
+  /* True if datagrams received are not consumed yet: */
+
+  bool pending() const { return _batch_position < _batch_count; }
+
+  /* Send the magic header and the frame's segments to count nodes, with a
+     sendmmsg call every PJON_UDP_BATCH_LENGTH nodes: */
+
+  void send_frame(
+    struct iovec *segments,
+    uint8_t segment_count,
+    const uint8_t (*remote_ip)[4],
+    const uint16_t *remote_port,
+    uint16_t count
+  ) {
+    segments[0].iov_base = &_magic_header;
+    segments[0].iov_len = 4;
+    struct mmsghdr messages[PJON_UDP_BATCH_LENGTH];
+    sockaddr_in addresses[PJON_UDP_BATCH_LENGTH];
+    for(uint16_t first = 0; first < count; first += PJON_UDP_BATCH_LENGTH) {
+      uint16_t length = count - first;
+      if(length > PJON_UDP_BATCH_LENGTH) length = PJON_UDP_BATCH_LENGTH;
+      memset(messages, 0, length * sizeof(struct mmsghdr));
+      for(uint16_t i = 0; i < length; i++) {
+        memset(&addresses[i], 0, sizeof(sockaddr_in));
+        addresses[i].sin_family = AF_INET;
+        addresses[i].sin_port = htons(remote_port[first + i]);
+        memcpy(&addresses[i].sin_addr.s_addr, remote_ip[first + i], 4);
+        messages[i].msg_hdr.msg_name = &addresses[i];
+        messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        messages[i].msg_hdr.msg_iov = segments;
+        messages[i].msg_hdr.msg_iovlen = segment_count;
+      }
+      for(uint16_t sent = 0; sent < length; ) {
+        int result = sendmmsg(_fd, messages + sent, length - sent, 0);
+        if(result <= 0) break;
+        sent += result;
+      }
+    }
+  }
+
+  void send_frame(
+    const uint8_t *string,
+    uint16_t length,
+    const uint8_t (*remote_ip)[4],
+    const uint16_t *remote_port,
+    uint16_t count
+  ) {
+    if(length > 0) {
+      struct iovec segments[2];
+      segments[1].iov_base = (void *)string;
+      segments[1].iov_len = length;
+      send_frame(segments, 2, remote_ip, remote_port, count);
+    }
+  }
+#else
+  /* The magic header is received in its own 4 bytes segment and the frame
+     directly in string, without copies: */
+
+  uint16_t receive_frame(uint8_t *string, uint16_t max_length) {
+    uint32_t header = 0;
+    sockaddr_in src_addr;
+    struct iovec segments[2];
+    segments[0].iov_base = &header;
+    segments[0].iov_len = 4;
+    segments[1].iov_base = string;
+    segments[1].iov_len = max_length;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = &src_addr;
+    message.msg_namelen = sizeof(src_addr);
+    message.msg_iov = segments;
+    message.msg_iovlen = 2;
+    ssize_t count = recvmsg(_fd, &message, 0);
+    if(count < 4) return false; // Reception failed
+    if(message.msg_flags & MSG_TRUNC) return false; // Too large packet
+    if(header != _magic_header) return false; // Not a LocalUDP packet
+    // Remember sender's address
+    memcpy(&_remote_sender_addr, &src_addr, sizeof(_remote_sender_addr));
+    return count - 4;
+  }
+#endif
+
+  /* Send the magic header and the frame's segments with a single sendmsg,
+     without composing them in a buffer: */
+
+  void send_frame(
+    struct iovec *segments,
+    uint8_t count,
+    const sockaddr_in &remote_addr
+  ) {
+    segments[0].iov_base = &_magic_header;
+    segments[0].iov_len = 4;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = (void *)&remote_addr;
+    message.msg_namelen = sizeof(remote_addr);
+    message.msg_iov = segments;
+    message.msg_iovlen = count;
+    sendmsg(_fd, &message, 0);
+  }
+
+  void send_frame(const uint8_t *string, uint16_t length, const sockaddr_in &remote_addr) {
+    if(length > 0) {
+      struct iovec segments[2];
+      segments[1].iov_base = (void *)string;
+      segments[1].iov_len = length;
+      send_frame(segments, 2, remote_addr);
+    }
+  }
+#endif
+
+#if(PJON_INCLUDE_SCATTER_GATHER)
+  // Send a frame composed by count segments, the magic header is prepended
+  void send_frame_v(const struct iovec *frame, uint8_t count, const sockaddr_in &remote_addr) {
+    if(count > PJON_MAX_FRAME_SEGMENTS) return;
+    struct iovec segments[PJON_MAX_FRAME_SEGMENTS + 1];
+    memcpy(&segments[1], frame, count * sizeof(struct iovec));
+    send_frame(segments, count + 1, remote_addr);
+  }
+
+#if(PJON_INCLUDE_UDP_BATCH) && !defined(_WIN32) && !defined(__ZEPHYR__)
+  void send_frame_v(
+    const struct iovec *frame,
+    uint8_t count,
+    const uint8_t (*remote_ip)[4],
+    const uint16_t *remote_port,
+    uint16_t nodes
+  ) {
+    if(count > PJON_MAX_FRAME_SEGMENTS) return;
+    struct iovec segments[PJON_MAX_FRAME_SEGMENTS + 1];
+    memcpy(&segments[1], frame, count * sizeof(struct iovec));
+    send_frame(segments, count + 1, remote_ip, remote_port, nodes);
+  }
+#endif
+
+  void send_frame_v(const struct iovec *frame, uint8_t count) {
+    _remote_receiver_addr.sin_port = htons(_port);
+    _remote_receiver_addr.sin_addr.s_addr = INADDR_BROADCAST;
+    send_frame_v(frame, count, _remote_receiver_addr);
+  }
+
+  void send_frame_v(const struct iovec *frame, uint8_t count, uint8_t *remote_ip, uint16_t remote_port) {
+    _remote_receiver_addr.sin_port = htons(remote_port);
+    _remote_receiver_addr.sin_addr.s_addr = *(uint32_t*)remote_ip;
+    send_frame_v(frame, count, _remote_receiver_addr);
+  }
+#endif
 
   void send_response(uint8_t *string, uint16_t length) {
     send_frame((const uint8_t *)string, length, _remote_sender_addr);
@@ -7,3 +7,10 @@
 #include "LINUX/PJON_LINUX_Interface.h"
 #include "ZEPHYR/PJON_ZEPHYR_Interface.h"
 #include "CROC/PJON_CROC_Interface.h"
+
+/* Delay used where sub-tick precision is required, it can use more CPU time
+   than PJON_DELAY_MICROSECONDS (see the LINUX interface): */
+
+#ifndef PJON_DELAY_MICROSECONDS_PRECISE
+  #define PJON_DELAY_MICROSECONDS_PRECISE PJON_DELAY_MICROSECONDS
+#endif
@@ -43,20 +43,41 @@
 #endif
 
 #include <PJONDefines.h>
+#include <utils/nodes/PJON_Node_Table.h>
 
-// Timeout waiting for an ACK. This can be increased if the latency is high
+#if(PJON_UDP_INBOX_LENGTH)
+  #include <utils/inbox/PJON_Inbox.h>
+#endif
+
+#if(PJON_INCLUDE_PIPELINED_ACK)
+  #include <utils/ack/PJON_Ack_Queue.h>
+#endif
+
+// Timeout waiting for an ACK. This can be increased if the latency is high.
+// It is the maximum, each node's timeout follows its round-trip time
 #ifndef DUDP_RESPONSE_TIMEOUT
   #define DUDP_RESPONSE_TIMEOUT          50000ul
 #endif
 
+// Minimum timeout waiting for an ACK of a node with a known round-trip time
+#ifndef DUDP_MIN_RESPONSE_TIMEOUT
+  #define DUDP_MIN_RESPONSE_TIMEOUT       1000ul
+#endif
+
 // Minimum time interval in ms between send attempts. Some devices go into 
 // contention if sending too fast. This can be overridden in an interface
 // for a device type, or in user sketches.
+// Pipelined acknowledgement needs packets to be sent back-to-back.
 #ifndef DUDP_MINIMUM_SEND_INTERVAL_MS 
-  #define DUDP_MINIMUM_SEND_INTERVAL_MS  8
+  #if(PJON_INCLUDE_PIPELINED_ACK)
+    #define DUDP_MINIMUM_SEND_INTERVAL_MS  0
+  #else
+    #define DUDP_MINIMUM_SEND_INTERVAL_MS  8
+  #endif
 #endif
 
-// Backoff function that can be overridden depending on network and devices
+// Backoff function that can be overridden depending on network and devices.
+// It is the minimum, nodes with a higher round-trip time back off longer
 #ifndef DUDP_BACKOFF
   #define DUDP_BACKOFF(attempts) (1000ul * attempts + PJON_RANDOM(500))
 #endif
@@ -66,7 +87,12 @@
   #define DUDP_MAX_RETRIES 5
 #endif
 
-// The size of the node table
+// Maximum back-off scaled with the round-trip time, in microseconds
+#ifndef DUDP_MAX_BACKOFF
+  #define DUDP_MAX_BACKOFF (DUDP_MAX_RETRIES * DUDP_RESPONSE_TIMEOUT)
+#endif
+
+// The maximum size of the node table (up to 254, see set_max_nodes)
 #ifndef DUDP_MAX_REMOTE_NODES
   #define DUDP_MAX_REMOTE_NODES               10
 #endif
@@ -77,6 +103,9 @@
 #endif
 
 #define DUDP_DEFAULT_PORT                   7500
+// Response length, 5 if it contains the packet id (pipelined acknowledgement)
+#define DUDP_RESPONSE_LENGTH                   3
+#define DUDP_ID_RESPONSE_LENGTH                5
 #define DUDP_MAGIC_HEADER  (uint32_t) 0x0EFA23FF
 
 // Recommended receive time for this strategy, in microseconds
@@ -93,12 +122,15 @@ class DualUDP {
          _did_broadcast = false;    // Whether last send was a broadcast
 
     uint16_t _port = DUDP_DEFAULT_PORT;
-    uint8_t  _unremovable_node_count = PJON_NOT_ASSIGNED;
 
     // Remember the details of the last outgoing packet
     uint8_t          _last_out_receiver_id = 0;
     uint8_t          _last_out_sender_id = 0;
     uint32_t         _last_out_time = 0;
+    #if(PJON_INCLUDE_PIPELINED_ACK)
+      uint8_t        _last_out_header = 0;
+      uint16_t       _last_out_packet_id = 0;
+    #endif
 
     // Remember the details of the last incoming packet
     PJON_Packet_Info _packet_info; // Also used for last outgoing
@@ -106,13 +138,19 @@ class DualUDP {
     uint8_t          _last_in_sender_ip[4];
     uint8_t          _last_in_receiver_id = 0;
     uint8_t          _last_in_sender_id = 0;
+    #if(PJON_INCLUDE_PIPELINED_ACK)
+      uint8_t        _last_in_header = 0;
+      uint16_t       _last_in_packet_id = 0;
+      PJON_Ack_Queue<PJON_ACK_QUEUE_LENGTH> _acks;
+    #endif
+
+    #if(PJON_UDP_INBOX_LENGTH)
+      // Frames received while waiting for an acknowledgement
+      PJON_Inbox<PJON_UDP_INBOX_LENGTH> _inbox;
+    #endif
 
     // Remote nodes table
-    uint8_t  _remote_node_count = 0;
-    uint8_t  _remote_id[DUDP_MAX_REMOTE_NODES];
-    uint8_t  _remote_ip[DUDP_MAX_REMOTE_NODES][4];
-    uint16_t _remote_port[DUDP_MAX_REMOTE_NODES];
-    uint8_t  _send_attempts[DUDP_MAX_REMOTE_NODES];
+    PJON_Node_Table<DUDP_MAX_REMOTE_NODES> _nodes;
 
     UDPHelper udp;
 
@@ -124,35 +162,68 @@ class DualUDP {
       return _udp_initialized;
     };
 
-    int16_t find_remote_node(uint8_t id) {
-      for(uint8_t i = 0; i < _remote_node_count; i++)
-        if(_remote_id[i] == id)
-          return i;
-      return -1;
-    };
-
     int16_t autoregister_sender() {
       // Add the last sender to the node table
       if(_auto_registration) {
         // If parsing fails, it will be 0
         if( _last_in_sender_id == 0) return -1;
         // See if PJON id is already registered, add if not
-        int16_t pos = find_remote_node( _last_in_sender_id);
-        if(pos == -1)
-          return add_node(
+        int16_t pos = _nodes.find(_last_in_sender_id);
+        if(pos == -1) {
+          #ifdef DUDP_DEBUG_PRINT
+            Serial.print("Register id "); Serial.print(_last_in_sender_id);
+            Serial.print(" ip "); Serial.println(_last_in_sender_ip[3]);
+          #endif
+          return _nodes.add(
             _last_in_sender_id,
             _last_in_sender_ip,
-            _last_in_sender_port
+            _last_in_sender_port,
+            false
           );
-        else { // Update IP and port of existing node
-          memcpy(_remote_ip[pos],  _last_in_sender_ip, 4);
-          _remote_port[pos] =  _last_in_sender_port;
-          return pos;
         }
+        // Update IP and port of existing node
+        memcpy(_nodes[pos].ip, _last_in_sender_ip, 4);
+        _nodes[pos].port = _last_in_sender_port;
+        _nodes.seen(pos);
+        return pos;
       }
       return -1;
     };
 
+    /* Receive a datagram and its sender, acknowledgements containing the
+       packet id are queued (returns PJON_FAIL): */
+
+    uint16_t receive_datagram(uint8_t *data, uint16_t max_length) {
+      uint16_t length = udp.receive_frame(data, max_length);
+      // Then get the IP address and port number of the sender
+      udp.get_sender(_last_in_sender_ip, _last_in_sender_port);
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        // Keep acknowledgements containing the packet id (never a packet)
+        if(length == DUDP_ID_RESPONSE_LENGTH) {
+          if(handle_response(data))
+            _acks.push(data[1], (data[3] << 8) | data[4]);
+          return PJON_FAIL;
+        }
+      #endif
+      return length;
+    };
+
+    /* Handle a response received, returns true if it is an acknowledgement
+       for a packet sent by this device: */
+
+    bool handle_response(const uint8_t *response) {
+      _last_in_receiver_id = response[0];
+      _last_in_sender_id = response[1];
+      // Ignore packets not responding to the last outgoing packet
+      if(_last_in_receiver_id != _last_out_sender_id) return false;
+      if(response[2] != PJON_ACK) return false;
+      // Autoregister sender of ACK
+      int16_t pos = autoregister_sender();
+      // Reset send attempt counter
+      if(pos != -1) _nodes[pos].acknowledged(DUDP_RESPONSE_TIMEOUT);
+      return true;
+    };
+
 public:
 
     /* Register each device we want to send to.
@@ -160,46 +231,51 @@ public:
        be filled automatically with devices that send to this device.
        Devices that this device will send to must be registered if they are
        outside the LAN and do not send a packet to this device first.
-       Devices on this LAN do not need to be manually registered. */
+       Devices on this LAN do not need to be manually registered.
+       Nodes registered with add_node are never removed, automatically
+       registered nodes are removed after DUDP_MAX_FAILURES failures or
+       replaced, when the table is full, by the least recently seen. */
 
     int16_t add_node(
       uint8_t remote_id,
       const uint8_t remote_ip[],
       uint16_t port_number = DUDP_DEFAULT_PORT
     ) {
-      if(_remote_node_count == DUDP_MAX_REMOTE_NODES) return -1;
-      // Remember how many nodes were present at startup
-      if(_unremovable_node_count == PJON_NOT_ASSIGNED)
-        _unremovable_node_count = _remote_node_count;
+      int16_t pos = _nodes.find(remote_id);
+      if((pos != -1) && !_nodes.remove(pos)) { // Already added, update it
+        memcpy(_nodes[pos].ip, remote_ip, 4);
+        _nodes[pos].port = port_number;
+        return pos;
+      }
       #ifdef DUDP_DEBUG_PRINT
         Serial.print("Register id "); Serial.print(remote_id);
         Serial.print(" ip "); Serial.println(remote_ip[3]);
       #endif
-      // Add the new node
-      _remote_id[_remote_node_count] = remote_id;
-      memcpy(_remote_ip[_remote_node_count], remote_ip, 4);
-      _remote_port[_remote_node_count] = port_number;
-      _send_attempts[_remote_node_count] = 0;
-      _remote_node_count++;
-      return _remote_node_count - 1;
+      return _nodes.add(remote_id, remote_ip, port_number, true);
     };
 
     /* Unregister a node, if unreachable */
 
     bool remove_node(uint8_t pos) {
       // Only allow the automatically added nodes to be removed
-      if(pos < _unremovable_node_count) return false;
+      if((pos >= _nodes.count()) || _nodes[pos].fixed) return false;
       #ifdef DUDP_DEBUG_PRINT
-        Serial.print("Unregistering id "); Serial.println(_remote_id[pos]);
+        Serial.print("Unregistering id "); Serial.println(_nodes[pos].id);
       #endif
-      for(uint8_t i = pos; i < _remote_node_count - 1; i++) {
-        _remote_id[i] = _remote_id[i + 1];
-        memcpy(_remote_ip[i], _remote_ip[i + 1], 4);
-        _remote_port[i] = _remote_port[i + 1];
-        _send_attempts[i] = _send_attempts[i + 1];
-      }
-      _remote_node_count--;
-      return true;
+      return _nodes.remove(pos);
+    };
+
+    /* Set the maximum number of nodes (up to DUDP_MAX_REMOTE_NODES): */
+
+    void set_max_nodes(uint8_t max_nodes) {
+      _nodes.set_capacity(max_nodes);
+    };
+
+    /* Returns the node registered with a device id, NULL if not present: */
+
+    const PJON_Node *get_node(uint8_t id) const {
+      int16_t pos = _nodes.find(id);
+      return (pos == -1) ? NULL : &_nodes[pos];
     };
 
     /* Whether the last send was a broadcast or a directed packet.
@@ -230,6 +306,36 @@ public:
       return DUDP_BACKOFF(attempts);
     };
 
+    /* Same as above, scaled with the round-trip time of the receiver (at
+       most DUDP_RESPONSE_TIMEOUT) up to DUDP_MAX_BACKOFF after a failed
+       attempt. Without a sample of the receiver the delay is not scaled: */
+
+    uint32_t back_off(uint8_t attempts, uint8_t receiver_id) {
+      uint32_t delay = DUDP_BACKOFF(attempts);
+      if(!attempts) return delay;
+      int16_t pos = _nodes.find(receiver_id);
+      if(pos == -1) return delay;
+      uint32_t srtt = _nodes[pos].rtt();
+      if(!srtt) return delay;
+      if(srtt > DUDP_RESPONSE_TIMEOUT) srtt = DUDP_RESPONSE_TIMEOUT;
+      uint32_t scaled = (attempts * srtt) + PJON_RANDOM(srtt / 2);
+      if(scaled > DUDP_MAX_BACKOFF) scaled = DUDP_MAX_BACKOFF;
+      return (scaled > delay) ? scaled : delay;
+    };
+
+    /* Returns the response timeout of a device in microseconds, derived
+       from its round-trip time within DUDP_MIN_RESPONSE_TIMEOUT and
+       DUDP_RESPONSE_TIMEOUT (the latter if unknown or not registered): */
+
+    uint32_t response_timeout(uint8_t id) const {
+      int16_t pos = _nodes.find(id);
+      uint32_t timeout = (pos == -1) ? 0 : _nodes[pos].timeout();
+      if(!timeout || (timeout > DUDP_RESPONSE_TIMEOUT))
+        return DUDP_RESPONSE_TIMEOUT;
+      if(timeout < DUDP_MIN_RESPONSE_TIMEOUT) return DUDP_MIN_RESPONSE_TIMEOUT;
+      return timeout;
+    };
+
     /* Begin method, to be called on initialization:
        (returns always true) */
 
@@ -241,8 +347,12 @@ public:
     /* Check if the channel is free for transmission */
 
     bool can_start() {
-      return check_udp() && ((uint32_t)(PJON_MILLIS() - _last_out_time) >=
-        DUDP_MINIMUM_SEND_INTERVAL_MS);
+      #if(DUDP_MINIMUM_SEND_INTERVAL_MS > 0)
+        return check_udp() && ((uint32_t)(PJON_MILLIS() - _last_out_time) >=
+          DUDP_MINIMUM_SEND_INTERVAL_MS);
+      #else
+        return check_udp(); // No interval between send attempts
+      #endif
     };
 
     /* Returns the maximum number of attempts for each transmission: */
@@ -253,6 +363,20 @@ public:
 
     static uint16_t get_receive_time() { return DUDP_RECEIVE_TIME; };
 
+    #if(PJON_INCLUDE_PIPELINED_ACK)
+
+      /* Returns the time in microseconds an acknowledgement is expected: */
+
+      static uint32_t get_response_timeout() { return DUDP_RESPONSE_TIMEOUT; };
+
+      /* Returns the oldest acknowledgement received, false if none: */
+
+      bool receive_acknowledge(uint8_t &device_id, uint16_t &packet_id) {
+        return _acks.pop(device_id, packet_id);
+      };
+
+    #endif
+
     /* Handle a collision (empty because handled on Ethernet level): */
 
     void handle_collision() { };
@@ -260,14 +384,26 @@ public:
     /* Receive a frame: */
 
     uint16_t receive_frame(uint8_t *data, uint16_t max_length) {
-      uint16_t length = udp.receive_frame(data, max_length);
-      // Then get the IP address and port number of the sender
-      udp.get_sender( _last_in_sender_ip,  _last_in_sender_port);
+      uint16_t length = PJON_FAIL;
+      #if(PJON_UDP_INBOX_LENGTH)
+        // Frames received while waiting for an acknowledgement come first
+        length = _inbox.pop(
+          data,
+          max_length,
+          _last_in_sender_ip,
+          _last_in_sender_port
+        );
+      #endif
+      if(length == PJON_FAIL) length = receive_datagram(data, max_length);
       if(length != PJON_FAIL && length > 4) {
         // Extract some info from the header
         PJONTools::parse_header(data, _packet_info);
          _last_in_receiver_id = _packet_info.rx.id;
          _last_in_sender_id = _packet_info.tx.id;
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          _last_in_header = _packet_info.header;
+          _last_in_packet_id = _packet_info.id;
+        #endif
         // Autoregister sender if the packet was sent directly
         if(
           _packet_info.tx.id != PJON_NOT_ASSIGNED &&
@@ -278,41 +414,81 @@ public:
       return length;
     };
 
-    /* Receive byte response */
+    #ifndef HAS_ETHERNETUDP
+
+      /* Socket to wait on for incoming frames (-1 before begin): */
+
+      int get_fd() const {
+        return udp.get_fd();
+      };
+
+      #if(PJON_INCLUDE_UDP_BATCH) || (PJON_UDP_INBOX_LENGTH)
+
+        /* True if frames received (in a batch or while waiting for an
+           acknowledgement) are not consumed yet: */
+
+        bool pending() const {
+          #if(PJON_UDP_INBOX_LENGTH)
+            if(_inbox.count) return true;
+          #endif
+          #if(PJON_INCLUDE_UDP_BATCH)
+            if(udp.pending()) return true;
+          #endif
+          return false;
+        };
+
+      #endif
+
+    #endif
+
+    /* Receive byte response, the frames received in the meantime are
+       queued for receive_frame: */
 
     uint16_t receive_response() {
       uint32_t start = PJON_MICROS();
-      uint8_t result[10];
+      uint32_t timeout = response_timeout(_last_out_receiver_id);
+      uint8_t response[10];
       uint16_t reply_length = 0;
       do {
-        reply_length = receive_frame(result, sizeof result);
+        uint8_t *result = response;
+        uint16_t max_length = sizeof response;
+        #if(PJON_UDP_INBOX_LENGTH)
+          // Receive directly in the inbox, if not full
+          typename PJON_Inbox<PJON_UDP_INBOX_LENGTH>::Frame *frame =
+            _inbox.back();
+          if(frame) {
+            result = frame->data;
+            max_length = PJON_PACKET_MAX_LENGTH;
+          }
+        #endif
+        reply_length = receive_datagram(result, max_length);
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          // Acknowledgements containing the packet id are queued
+          if(
+            (_last_out_header & PJON_PACKET_ID_BIT) &&
+            _acks.remove(_last_out_receiver_id, _last_out_packet_id)
+          ) return PJON_ACK;
+        #endif
         if(reply_length == PJON_FAIL) continue;
 
+        #if(PJON_UDP_INBOX_LENGTH)
+          // Keep full PJON packets for receive_frame
+          if(frame && (reply_length > 4)) {
+            _inbox.push(reply_length, _last_in_sender_ip, _last_in_sender_port);
+            continue;
+          }
+        #endif
+
         // Ignore full PJON packets, we expect only a tiny response packet
-        if(reply_length != 3) continue;
-
-        // Decode response packet
-        _last_in_receiver_id = result[0];
-        _last_in_sender_id = result[1];
-        uint8_t code = result[2];
-
-        // Ignore packets not responding to the last outgoing packet
-        if(_last_in_receiver_id != _last_out_sender_id) continue;
-
-        // Ignore packets not from the receiver of the last outgoing packet
-        // 20181205: NO, allow these ACKS even if they are delayed,
-        // because it could be caused by forwarding multiple hops,
-        // and a delayed ACK is still a confirmation of the correct route.
-        //if(_last_in_sender_id != _last_out_receiver_id) continue;
-
-        if(code == PJON_ACK) {
-          // Autoregister sender of ACK
-          int16_t pos = autoregister_sender();
-          // Reset send attempt counter
-          if(pos != -1) _send_attempts[pos] = 0;
-          return code;
-        }
-      } while((uint32_t)(PJON_MICROS() - start) < DUDP_RESPONSE_TIMEOUT);
+        if(reply_length != DUDP_RESPONSE_LENGTH) continue;
+
+        // Accept only the response of the receiver of the last outgoing
+        // packet (also if forwarded by routers, they respond with its id)
+        if(
+          handle_response(result) &&
+          (_last_in_sender_id == _last_out_receiver_id)
+        ) return PJON_ACK;
+      } while((uint32_t)(PJON_MICROS() - start) < timeout);
       #ifdef DUDP_DEBUG_PRINT
         Serial.println("Receive_response FAILED");
       #endif
@@ -320,16 +496,36 @@ public:
     };
 
     /* Send byte response to package transmitter.
-       We have the IP so we can reply directly.
+       We have the IP so we can reply directly (the sender of the last frame
+       returned by receive_frame, that may have been queued).
        Use the receiver id of the last incoming packet instead of the id of
        this device, to function also in router mode. */
 
     void send_response(uint8_t response) { // Empty, PJON_ACK is always sent
-      uint8_t buf[3];
+      uint8_t buf[DUDP_ID_RESPONSE_LENGTH];
       buf[0] = _last_in_sender_id;   // Send to the device last received from
       buf[1] = _last_in_receiver_id; // Send from the id last received to
       buf[2] = response;
-      udp.send_response(buf, 3);
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        // Include the packet id so the sender can match the response
+        if(_last_in_header & PJON_PACKET_ID_BIT) {
+          buf[3] = (uint8_t)(_last_in_packet_id >> 8);
+          buf[4] = (uint8_t)_last_in_packet_id;
+          udp.send_frame(
+            buf,
+            DUDP_ID_RESPONSE_LENGTH,
+            _last_in_sender_ip,
+            _last_in_sender_port
+          );
+          return;
+        }
+      #endif
+      udp.send_frame(
+        buf,
+        DUDP_RESPONSE_LENGTH,
+        _last_in_sender_ip,
+        _last_in_sender_port
+      );
     };
 
     /* Send a frame: */
@@ -337,38 +533,69 @@ public:
     void send_frame(uint8_t *data, uint16_t length) {
       _did_broadcast = false;
       if(length > 4) {
-        // Extract some info from the header
-        PJONTools::parse_header(data, _packet_info);
-         _last_out_receiver_id = _packet_info.rx.id;
-         _last_out_sender_id = _packet_info.tx.id;
-
-        // Locate receiver in table unless it is a PJON broadcast (receiver 0)
-        int16_t pos = -1;
-        if(_last_out_receiver_id != 0)
-          pos = find_remote_node(_last_out_receiver_id);
-
-        // Check if receiver is not responding and should be unregistered
-        if(
-          pos != -1 &&
-          (_send_attempts[pos] > (get_max_attempts() * DUDP_MAX_FAILURES)) &&
-          remove_node((uint8_t)pos)
-        ) pos = -1;
-
+        int16_t pos = locate_receiver(data);
         if(pos == -1) { // UDP Broadcast, send to all receivers
           if(_auto_discovery) udp.send_frame(data, length);
-          _did_broadcast = true;
-          #ifdef DUDP_DEBUG_PRINT
-            Serial.print("Broadcast, id ");
-            Serial.println(_last_out_receiver_id);
-          #endif
-        } else { // To a specific IP+port
-          udp.send_frame(data, length, _remote_ip[pos], _remote_port[pos]);
-          _send_attempts[pos]++;
-        }
+        } else // To a specific IP+port
+          udp.send_frame(data, length, _nodes[pos].ip, _nodes[pos].port);
         _last_out_time = PJON_MILLIS();
       }
     };
 
+    #if(PJON_INCLUDE_SCATTER_GATHER)
+
+      /* Send a frame composed by count segments, the first contains the
+         whole header: */
+
+      void send_frame_v(const struct iovec *frame, uint8_t count) {
+        _did_broadcast = false;
+        if(count && (frame[0].iov_len > 4)) {
+          int16_t pos = locate_receiver((const uint8_t *)frame[0].iov_base);
+          if(pos == -1) { // UDP Broadcast, send to all receivers
+            if(_auto_discovery) udp.send_frame_v(frame, count);
+          } else // To a specific IP+port
+            udp.send_frame_v(frame, count, _nodes[pos].ip, _nodes[pos].port);
+          _last_out_time = PJON_MILLIS();
+        }
+      };
+
+    #endif
+
+    /* Extract some info from the header of a frame about to be sent and
+       return the position of its receiver in the table or -1 to broadcast: */
+
+    int16_t locate_receiver(const uint8_t *data) {
+      PJONTools::parse_header(data, _packet_info);
+      _last_out_receiver_id = _packet_info.rx.id;
+      _last_out_sender_id = _packet_info.tx.id;
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        _last_out_header = _packet_info.header;
+        _last_out_packet_id = _packet_info.id;
+      #endif
+
+      // Locate receiver in table unless it is a PJON broadcast (receiver 0)
+      int16_t pos = -1;
+      if(_last_out_receiver_id != 0)
+        pos = _nodes.find(_last_out_receiver_id);
+
+      // Check if receiver is not responding and should be unregistered
+      if(
+        pos != -1 &&
+        (_nodes[pos].failures > (get_max_attempts() * DUDP_MAX_FAILURES)) &&
+        remove_node((uint8_t)pos)
+      ) pos = -1;
+
+      if(pos == -1) {
+        _did_broadcast = true;
+        #ifdef DUDP_DEBUG_PRINT
+          Serial.print("Broadcast, id ");
+          Serial.println(_last_out_receiver_id);
+        #endif
+      } else if(_packet_info.header & PJON_ACK_REQ_BIT)
+        _nodes[pos].transmitted(); // Failures counted, response timed
+      return pos;
+    };
+
     /* Set the UDP port: */
 
     void set_port(uint16_t port = DUDP_DEFAULT_PORT) {
@@ -762,6 +762,13 @@ public:
     bool ok = client.write((uint8_t*) buf, 9) == 9;
     if(ok) ok = client.write((uint8_t*) packet, length) == length;
     if(ok) ok = client.write((uint8_t*) &foot, 4) == 4;
+    #elif(PJON_INCLUDE_SCATTER_GATHER)
+    // Written with a single system call, so that it will not be sent as
+    // 3 separate packets when TCP_NODELAY is active, without copying.
+    struct iovec segments[3] = {
+      {buf, 9}, {(void *)packet, length}, {&foot, 4}
+    };
+    bool ok = client.write_v(segments, 3) == (9+length+4);
     #else
     // On a POSIX capable device we expect to have enough memory to collect all into one buffer
     // so that it will not be sent as 3 separate packets when TCP_NODELAY is active.
@@ -1048,6 +1055,18 @@ public:
   };
 
 
+  #ifndef ARDUINO
+  /* Socket to wait on for incoming data when listening: the incoming
+     connection if established, otherwise the listening socket. Returns -1 if
+     not listening, the link must then be polled calling receive. */
+
+  int get_fd() {
+    if(_server == NULL) return -1;
+    return _client_in ? _client_in.get_fd() : _server->get_fd();
+  };
+  #endif
+
+
   /* Whether to keep outgoing connection live until we need connect to
      another EthernetLink node */
 
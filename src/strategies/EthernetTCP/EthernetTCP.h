@@ -117,6 +117,17 @@ class EthernetTCP {
     void handle_collision() { };
 
 
+    #ifndef ARDUINO
+
+      /* Socket to wait on for incoming frames (see EthernetLink::get_fd): */
+
+      int get_fd() {
+        return link.get_fd();
+      };
+
+    #endif
+
+
     /* Receive a frame: */
 
     uint16_t receive_frame(uint8_t *data, uint16_t max_length) {
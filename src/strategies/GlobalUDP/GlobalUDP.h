@@ -28,12 +28,33 @@
 #endif
 
 #include <PJONDefines.h>
+#include "../../utils/nodes/PJON_Node_Table.h"
+
+#if(PJON_UDP_INBOX_LENGTH)
+  #include "../../utils/inbox/PJON_Inbox.h"
+#endif
+
+#if(PJON_INCLUDE_PIPELINED_ACK)
+  #include "../../utils/ack/PJON_Ack_Queue.h"
+#endif
 
 // Timeout waiting for an ACK. This can be increased if the latency is high.
+// It is the maximum, each node's timeout follows its round-trip time
 #ifndef GUDP_RESPONSE_TIMEOUT
   #define GUDP_RESPONSE_TIMEOUT         100000ul
 #endif
 
+// Minimum timeout waiting for an ACK of a node with a known round-trip time
+#ifndef GUDP_MIN_RESPONSE_TIMEOUT
+  #define GUDP_MIN_RESPONSE_TIMEOUT       1000ul
+#endif
+
+// Maximum back-off scaled with the round-trip time, in microseconds
+#ifndef GUDP_MAX_BACKOFF
+  #define GUDP_MAX_BACKOFF (10 * GUDP_RESPONSE_TIMEOUT)
+#endif
+
+// The maximum size of the node table (up to 254, see set_max_nodes)
 #ifndef GUDP_MAX_REMOTE_NODES
   #define GUDP_MAX_REMOTE_NODES               10
 #endif
@@ -45,6 +66,8 @@
 
 #define GUDP_DEFAULT_PORT                    7000
 #define GUDP_MAGIC_HEADER   (uint32_t) 0x0DFAC3FF
+// Response length if it contains the packet id (pipelined acknowledgement)
+#define GUDP_ID_RESPONSE_LENGTH                 4
 
 class GlobalUDP {
     bool _udp_initialized = false;
@@ -52,10 +75,23 @@ class GlobalUDP {
     bool _auto_registration = true;
 
     // Remote nodes
-    uint8_t  _remote_node_count = 0;
-    uint8_t  _remote_id[GUDP_MAX_REMOTE_NODES];
-    uint8_t  _remote_ip[GUDP_MAX_REMOTE_NODES][4];
-    uint16_t _remote_port[GUDP_MAX_REMOTE_NODES];
+    PJON_Node_Table<GUDP_MAX_REMOTE_NODES> _nodes;
+
+    // Sender of the last incoming frame, receiver of the last outgoing one
+    uint8_t  _last_in_ip[4], _last_out_ip[4];
+    uint16_t _last_in_port = 0, _last_out_port = 0;
+    uint8_t  _last_out_id = 0;
+
+    #if(PJON_UDP_INBOX_LENGTH)
+      // Frames received while waiting for an acknowledgement
+      PJON_Inbox<PJON_UDP_INBOX_LENGTH> _inbox;
+    #endif
+
+    #if(PJON_INCLUDE_PIPELINED_ACK)
+      // Info of the last incoming and outgoing packets
+      PJON_Packet_Info _last_in, _last_out;
+      PJON_Ack_Queue<PJON_ACK_QUEUE_LENGTH> _acks;
+    #endif
 
     UDPHelper udp;
 
@@ -67,13 +103,6 @@ class GlobalUDP {
       return _udp_initialized;
     };
 
-    int16_t find_remote_node(uint8_t id) {
-      for(uint8_t i = 0; i < _remote_node_count; i++)
-        if(_remote_id[i] == id)
-          return i;
-      return -1;
-    };
-
     void autoregister_sender(const uint8_t *message, uint16_t length) {
       // Add the last sender to the node table
       if (_auto_registration && length>4) {
@@ -83,37 +112,109 @@ class GlobalUDP {
         uint8_t sender_id = packet_info.tx.id;
         if (sender_id == 0) return; // If parsing fails, it will be 0
 
-        // Then get the IP address and port number of the sender
-        uint8_t sender_ip[4];
-        uint16_t sender_port;
-        udp.get_sender(sender_ip, sender_port);
-
         // See if PJON id is already registered, add if not
-        int16_t pos = find_remote_node(sender_id);
-        if (pos == -1) add_node(sender_id, sender_ip, sender_port);
+        int16_t pos = _nodes.find(sender_id);
+        if (pos == -1) _nodes.add(sender_id, _last_in_ip, _last_in_port, false);
         else {
           // Update IP and port of existing node
-          memcpy(_remote_ip[pos], sender_ip, 4);
-          _remote_port[pos] = sender_port;
+          memcpy(_nodes[pos].ip, _last_in_ip, 4);
+          _nodes[pos].port = _last_in_port;
+          _nodes.seen(pos);
         }
       }
     }
 
+    /* Receive a datagram and its sender, acknowledgements containing the
+       packet id are queued (returns PJON_FAIL): */
+
+    uint16_t receive_datagram(uint8_t *data, uint16_t max_length) {
+      uint16_t length = udp.receive_frame(data, max_length);
+      udp.get_sender(_last_in_ip, _last_in_port);
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        // Keep acknowledgements containing the packet id (never a packet)
+        if(length == GUDP_ID_RESPONSE_LENGTH) {
+          if(data[0] == PJON_ACK) {
+            _acks.push(data[1], (data[2] << 8) | data[3]);
+            acknowledged(data[1]);
+          }
+          return PJON_FAIL;
+        }
+      #endif
+      return length;
+    };
+
+    /* Records the address of the receiver of a directed frame, the only
+       sender from which an acknowledgement is accepted, and times the
+       response if the frame requests it: */
+
+    void set_last_out(uint8_t pos, uint8_t header) {
+      memcpy(_last_out_ip, _nodes[pos].ip, 4);
+      _last_out_port = _nodes[pos].port;
+      if(header & PJON_ACK_REQ_BIT) _nodes[pos].transmitted();
+    };
+
+    /* Measures the round-trip time of a node that acknowledged a frame: */
+
+    void acknowledged(uint8_t id) {
+      int16_t pos = _nodes.find(id);
+      if(pos != -1) _nodes[pos].acknowledged(GUDP_RESPONSE_TIMEOUT);
+    };
+
+    #if(PJON_INCLUDE_UDP_BATCH) && !defined(HAS_ETHERNETUDP)
+
+      /* Send the segments (the first is left for the magic header) to all
+         the nodes, gathering their addresses PJON_UDP_BATCH_LENGTH at a
+         time for UDPHelper: */
+
+      void send_batch(struct iovec *segments, uint8_t segment_count) {
+        uint8_t  ip[PJON_UDP_BATCH_LENGTH][4];
+        uint16_t port[PJON_UDP_BATCH_LENGTH];
+        uint16_t length = 0;
+        for(uint8_t pos = 0; pos < _nodes.count(); pos++) {
+          memcpy(ip[length], _nodes[pos].ip, 4);
+          port[length++] = _nodes[pos].port;
+          if((length < PJON_UDP_BATCH_LENGTH) && (pos + 1 < _nodes.count()))
+            continue;
+          udp.send_frame(segments, segment_count, ip, port, length);
+          length = 0;
+        }
+      };
+
+    #endif
+
 public:
 
-    /* Register each device we want to send to */
+    /* Register each device we want to send to. These nodes are never
+       removed, when the table is full the least recently seen of the
+       automatically registered nodes is replaced. */
 
     int16_t add_node(
       uint8_t remote_id,
       const uint8_t remote_ip[],
       uint16_t port_number = GUDP_DEFAULT_PORT
     ) {
-      if (_remote_node_count == GUDP_MAX_REMOTE_NODES) return -1;
-      _remote_id[_remote_node_count] = remote_id;
-      memcpy(_remote_ip[_remote_node_count], remote_ip, 4);
-      _remote_port[_remote_node_count] = port_number;
-      _remote_node_count++;
-      return _remote_node_count - 1;
+      int16_t pos = _nodes.find(remote_id);
+      if ((pos != -1) && !_nodes.remove(pos)) { // Already added, update it
+        memcpy(_nodes[pos].ip, remote_ip, 4);
+        _nodes[pos].port = port_number;
+        return pos;
+      }
+      return _nodes.add(remote_id, remote_ip, port_number, true);
+    };
+
+
+    /* Set the maximum number of nodes (up to GUDP_MAX_REMOTE_NODES): */
+
+    void set_max_nodes(uint8_t max_nodes) {
+      _nodes.set_capacity(max_nodes);
+    };
+
+
+    /* Returns the node registered with a device id, NULL if not present: */
+
+    const PJON_Node *get_node(uint8_t id) const {
+      int16_t pos = _nodes.find(id);
+      return (pos == -1) ? NULL : &_nodes[pos];
     };
 
 
@@ -138,6 +239,37 @@ public:
       #endif
     };
 
+    /* Same as above, scaled with the round-trip time of the receiver (at
+       most GUDP_RESPONSE_TIMEOUT) up to GUDP_MAX_BACKOFF after a failed
+       attempt. Without a sample of the receiver the delay is not scaled: */
+
+    uint32_t back_off(uint8_t attempts, uint8_t receiver_id) {
+      uint32_t delay = back_off(attempts);
+      if(!attempts) return delay;
+      int16_t pos = _nodes.find(receiver_id);
+      if(pos == -1) return delay;
+      uint32_t srtt = _nodes[pos].rtt();
+      if(!srtt) return delay;
+      if(srtt > GUDP_RESPONSE_TIMEOUT) srtt = GUDP_RESPONSE_TIMEOUT;
+      uint32_t scaled = (attempts * srtt) + PJON_RANDOM(srtt / 2);
+      if(scaled > GUDP_MAX_BACKOFF) scaled = GUDP_MAX_BACKOFF;
+      return (scaled > delay) ? scaled : delay;
+    };
+
+
+    /* Returns the response timeout of a device in microseconds, derived
+       from its round-trip time within GUDP_MIN_RESPONSE_TIMEOUT and
+       GUDP_RESPONSE_TIMEOUT (the latter if unknown or not registered): */
+
+    uint32_t response_timeout(uint8_t id) const {
+      int16_t pos = _nodes.find(id);
+      uint32_t timeout = (pos == -1) ? 0 : _nodes[pos].timeout();
+      if(!timeout || (timeout > GUDP_RESPONSE_TIMEOUT))
+        return GUDP_RESPONSE_TIMEOUT;
+      if(timeout < GUDP_MIN_RESPONSE_TIMEOUT) return GUDP_MIN_RESPONSE_TIMEOUT;
+      return timeout;
+    };
+
 
     /* Begin method, to be called on initialization:
        (returns always true) */
@@ -160,6 +292,22 @@ public:
     static uint16_t get_receive_time() { return GUDP_RECEIVE_TIME; };
 
 
+    #if(PJON_INCLUDE_PIPELINED_ACK)
+
+      /* Returns the time in microseconds an acknowledgement is expected: */
+
+      static uint32_t get_response_timeout() { return GUDP_RESPONSE_TIMEOUT; };
+
+
+      /* Returns the oldest acknowledgement received, false if none: */
+
+      bool receive_acknowledge(uint8_t &device_id, uint16_t &packet_id) {
+        return _acks.pop(device_id, packet_id);
+      };
+
+    #endif
+
+
     /* Handle a collision (empty because handled on Ethernet level): */
 
     void handle_collision() { };
@@ -168,39 +316,128 @@ public:
     /* Receive a frame: */
 
     uint16_t receive_frame(uint8_t *data, uint16_t max_length) {
-      uint16_t length = udp.receive_frame(data, max_length);
+      uint16_t length = PJON_FAIL;
+      #if(PJON_UDP_INBOX_LENGTH)
+        // Frames received while waiting for an acknowledgement come first
+        length = _inbox.pop(data, max_length, _last_in_ip, _last_in_port);
+      #endif
+      if (length == PJON_FAIL) length = receive_datagram(data, max_length);
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        if(length != PJON_FAIL && length > 4)
+          PJONTools::parse_header(data, _last_in);
+      #endif
       if (length != PJON_FAIL) autoregister_sender(data, length);
       return length;
     }
 
 
-    /* Receive byte response */
+    #ifndef HAS_ETHERNETUDP
+
+      /* Socket to wait on for incoming frames (-1 before begin): */
+
+      int get_fd() const {
+        return udp.get_fd();
+      };
+
+      #if(PJON_INCLUDE_UDP_BATCH) || (PJON_UDP_INBOX_LENGTH)
+
+        /* True if frames received (in a batch or while waiting for an
+           acknowledgement) are not consumed yet: */
+
+        bool pending() const {
+          #if(PJON_UDP_INBOX_LENGTH)
+            if(_inbox.count) return true;
+          #endif
+          #if(PJON_INCLUDE_UDP_BATCH)
+            if(udp.pending()) return true;
+          #endif
+          return false;
+        };
+
+      #endif
+
+    #endif
+
+
+    /* Receive byte response, the frames received in the meantime are
+       queued for receive_frame: */
 
     uint16_t receive_response() {
-      /* TODO: Improve robustness by ignoring packets not from the previous
-         receiver (Perhaps not that important as long as ACK/NAK responses are
-         directed, not broadcast) */
       uint32_t start = PJON_MICROS();
-      uint8_t result[8];
+      uint32_t timeout = response_timeout(_last_out_id);
+      uint8_t response[8];
       uint16_t reply_length = 0;
       do {
-        reply_length = receive_frame(result, sizeof result);
-
-        // We expect 1, if packet is larger it is not our ACK
-        if(reply_length == 1)
-          if (result[0] == PJON_ACK)
-            return result[0];
+        uint8_t *result = response;
+        uint16_t max_length = sizeof response;
+        #if(PJON_UDP_INBOX_LENGTH)
+          // Receive directly in the inbox, if not full
+          typename PJON_Inbox<PJON_UDP_INBOX_LENGTH>::Frame *frame =
+            _inbox.back();
+          if(frame) {
+            result = frame->data;
+            max_length = PJON_PACKET_MAX_LENGTH;
+          }
+        #endif
+        reply_length = receive_datagram(result, max_length);
+
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          // Acknowledgements containing the packet id are queued
+          if(
+            (_last_out.header & PJON_PACKET_ID_BIT) &&
+            _acks.remove(_last_out.rx.id, _last_out.id)
+          ) return PJON_ACK;
+        #endif
+
+        if(reply_length == PJON_FAIL) continue;
+
+        #if(PJON_UDP_INBOX_LENGTH)
+          // Keep full PJON packets for receive_frame
+          if(frame && (reply_length > 4)) {
+            _inbox.push(reply_length, _last_in_ip, _last_in_port);
+            continue;
+          }
+        #endif
+
+        // We expect 1 from the receiver, if larger it is not our ACK
+        if(
+          (reply_length == 1) && (result[0] == PJON_ACK) &&
+          !memcmp(_last_in_ip, _last_out_ip, 4) &&
+          (_last_in_port == _last_out_port)
+        ) {
+          acknowledged(_last_out_id);
+          return PJON_ACK;
+        }
 
-      } while ((uint32_t)(PJON_MICROS() - start) < GUDP_RESPONSE_TIMEOUT);
+      } while ((uint32_t)(PJON_MICROS() - start) < timeout);
       return PJON_FAIL;
     };
 
 
     /* Send byte response to package transmitter.
-       We have the IP so we can reply directly. */
+       We have the IP so we can reply directly (the sender of the last frame
+       returned by receive_frame, that may have been queued). */
 
     void send_response(uint8_t response) { // Empty, PJON_ACK is always sent
-      udp.send_response(response);
+      #if(PJON_INCLUDE_PIPELINED_ACK)
+        // Include the packet id so the sender can match the response
+        if(_last_in.header & PJON_PACKET_ID_BIT) {
+          uint8_t buf[GUDP_ID_RESPONSE_LENGTH] = {
+            response,
+            _last_in.rx.id,
+            (uint8_t)(_last_in.id >> 8),
+            (uint8_t)_last_in.id
+          };
+          udp.send_frame(
+            buf,
+            GUDP_ID_RESPONSE_LENGTH,
+            _last_in_ip,
+            _last_in_port
+          );
+          return;
+        }
+      #endif
+      udp.send_frame(&response, 1, _last_in_ip, _last_in_port);
     };
 
 
@@ -208,19 +445,64 @@ public:
 
     void send_frame(uint8_t *data, uint16_t length) {
       if(length > 0) {
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          if(length > 4) PJONTools::parse_header(data, _last_out);
+        #endif
         uint8_t id = data[0]; // Package always starts with a receiver id
+        _last_out_id = id;
         if (id == 0) { // Broadcast, send to all receivers
-          for(uint8_t pos = 0; pos < _remote_node_count; pos++)
-            udp.send_frame(data, length, _remote_ip[pos], _remote_port[pos]);
+          #if(PJON_INCLUDE_UDP_BATCH) && !defined(HAS_ETHERNETUDP)
+            struct iovec segments[2];
+            segments[1].iov_base = data;
+            segments[1].iov_len = length;
+            send_batch(segments, 2);
+          #else
+            for(uint8_t pos = 0; pos < _nodes.count(); pos++)
+              udp.send_frame(data, length, _nodes[pos].ip, _nodes[pos].port);
+          #endif
         } else { // To a specific receiver
-          int16_t pos = find_remote_node(id);
+          int16_t pos = _nodes.find(id);
           if (pos != -1) {
-            udp.send_frame(data, length, _remote_ip[pos], _remote_port[pos]);
+            set_last_out(pos, data[1]);
+            udp.send_frame(data, length, _nodes[pos].ip, _nodes[pos].port);
           }
         }
       }
     };
 
+    #if(PJON_INCLUDE_SCATTER_GATHER)
+
+      /* Send a frame composed by count segments, the first contains the
+         whole header: */
+
+      void send_frame_v(const struct iovec *frame, uint8_t count) {
+        if(!count || !frame[0].iov_len) return;
+        const uint8_t *data = (const uint8_t *)frame[0].iov_base;
+        #if(PJON_INCLUDE_PIPELINED_ACK)
+          if(frame[0].iov_len > 4) PJONTools::parse_header(data, _last_out);
+        #endif
+        _last_out_id = data[0];
+        if(data[0] == 0) { // Broadcast, send to all receivers
+          #if(PJON_INCLUDE_UDP_BATCH) && !defined(HAS_ETHERNETUDP)
+            if(count > PJON_MAX_FRAME_SEGMENTS) return;
+            struct iovec segments[PJON_MAX_FRAME_SEGMENTS + 1];
+            memcpy(&segments[1], frame, count * sizeof(struct iovec));
+            send_batch(segments, count + 1);
+          #else
+            for(uint8_t pos = 0; pos < _nodes.count(); pos++)
+              udp.send_frame_v(frame, count, _nodes[pos].ip, _nodes[pos].port);
+          #endif
+        } else { // To a specific receiver
+          int16_t pos = _nodes.find(data[0]);
+          if(pos != -1) {
+            set_last_out(pos, data[1]);
+            udp.send_frame_v(frame, count, _nodes[pos].ip, _nodes[pos].port);
+          }
+        }
+      };
+
+    #endif
+
 
     /* Set the UDP port: */
 
@@ -5,6 +5,10 @@
 
 #include "PJON.h"
 
+#ifdef __linux__
+  #include <sys/inotify.h>
+#endif
+
 // The maximum number of messages in the content file
 #ifndef LF_QUEUESIZE
   #define LF_QUEUESIZE 20
@@ -38,6 +42,11 @@ class LocalFile {
 
     uint16_t last_send_result = PJON_ACK;
 
+    #ifdef __linux__
+      // inotify instance notified when the content file is written
+      int watch = -1;
+    #endif
+
     struct Record {
       uint16_t length;
       uint8_t message[PJON_PACKET_MAX_LENGTH];
@@ -215,6 +224,9 @@ class LocalFile {
 
     ~LocalFile() {
       closeContentFile();
+      #ifdef __linux__
+        if(watch != -1) close(watch);
+      #endif
     };
 
     uint32_t back_off(uint8_t attempts) {
@@ -242,9 +254,39 @@ class LocalFile {
       return LF_RECEIVE_TIME;
     };
 
+    #ifdef __linux__
+
+      /* Descriptor readable when the content file is written, created by the
+         first call. Once used receive_frame does not sleep LF_POLLDELAY: */
+
+      int get_fd() {
+        if(watch != -1 || !openContentFile()) return watch;
+        watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(
+          (watch != -1) &&
+          (inotify_add_watch(watch, LF_FILENAME, IN_MODIFY) == -1)
+        ) {
+          close(watch);
+          watch = -1;
+        }
+        return watch;
+      };
+
+    #endif
+
     uint16_t receive_frame(uint8_t *data, uint16_t max_length) {
       Record record;
-      if(readNextPacketFromFile(record)) {
+      bool found = readNextPacketFromFile(record);
+      #ifdef __linux__
+        if(!found && (watch != -1)) {
+          // Consume the notifications, then check a write done meanwhile
+          char events[256];
+          while(read(watch, events, sizeof(events)) > 0);
+          found = readNextPacketFromFile(record);
+          if(!found) return PJON_FAIL;
+        }
+      #endif
+      if(found) {
         uint16_t length =
           record.length < max_length ? record.length : max_length;
         memcpy(data, record.message, length);
@@ -100,6 +100,27 @@ public:
     }
 
 
+    #ifndef HAS_ETHERNETUDP
+
+      /* Socket to wait on for incoming frames (-1 before begin): */
+
+      int get_fd() const {
+        return udp.get_fd();
+      };
+
+      #if(PJON_INCLUDE_UDP_BATCH)
+
+        /* True if datagrams received in a batch are not consumed yet: */
+
+        bool pending() const {
+          return udp.pending();
+        };
+
+      #endif
+
+    #endif
+
+
     /* Receive byte response */
 
     uint16_t receive_response() {
@@ -136,6 +157,16 @@ public:
       udp.send_frame(data, length);
     };
 
+    #if(PJON_INCLUDE_SCATTER_GATHER)
+
+      /* Send a frame composed by count segments: */
+
+      void send_frame_v(const struct iovec *frame, uint8_t count) {
+        udp.send_frame_v(frame, count);
+      };
+
+    #endif
+
 
     /* Set the UDP port: */
 
@@ -0,0 +1,95 @@
+/* ThroughSerial buffered serial port access on Linux
+   ____________________________________________________________________________
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#pragma once
+
+/* Reception buffer of a serial port file descriptor (set non-blocking by
+   ThroughSerial::set_serial). When it is empty a single read drains all the
+   bytes available (up to TS_BUFFER_LENGTH), then the bytes are consumed
+   one at a time by the state machine of ThroughSerial without system calls.
+
+   TSSerialBuffer::write transmits a frame already encoded in memory with a
+   single write (more if the output queue of the port is full, waiting in
+   poll until it has room). */
+
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+/* Length of the reception buffer in bytes */
+#ifndef TS_BUFFER_LENGTH
+  #define TS_BUFFER_LENGTH 512
+#endif
+
+struct TSSerialBuffer {
+  uint8_t  data[TS_BUFFER_LENGTH];
+  uint16_t head = 0;
+  uint16_t tail = 0;
+
+  /* Returns the number of bytes buffered, reads the port if none: */
+
+  uint16_t available(int fd) {
+    if(head == tail) {
+      ssize_t result = read(fd, data, TS_BUFFER_LENGTH);
+      head = 0;
+      tail = (result > 0) ? (uint16_t)result : 0;
+    }
+    return tail - head;
+  };
+
+  int16_t read_byte(int fd) {
+    if(!available(fd)) return -1;
+    return data[head++];
+  };
+
+  /* True if bytes were read from the port and not yet consumed: */
+
+  bool pending() const {
+    return head != tail;
+  };
+
+  void clear() {
+    head = tail = 0;
+  };
+
+  /* Writes length bytes, returns false if the port failed or no byte could
+     be written for timeout microseconds (as writing a byte at a time): */
+
+  static bool write(
+    int fd,
+    const uint8_t *frame,
+    uint16_t length,
+    uint32_t timeout
+  ) {
+    uint32_t time = PJON_MICROS();
+    uint16_t written = 0;
+    while(written < length) {
+      ssize_t result = ::write(fd, frame + written, length - written);
+      if(result > 0) {
+        written += result;
+        time = PJON_MICROS();
+        continue;
+      }
+      if((result < 0) && (errno != EAGAIN) && (errno != EINTR)) return false;
+      uint32_t elapsed = PJON_MICROS() - time;
+      if(elapsed >= timeout) return false;
+      // Sleeps until the output queue has room or the time left expires
+      struct pollfd port = {fd, POLLOUT, 0};
+      int wait = (int)((timeout - elapsed + 999) / 1000);
+      if((poll(&port, 1, wait) < 0) && (errno != EINTR)) return false;
+    }
+    return true;
+  };
+};
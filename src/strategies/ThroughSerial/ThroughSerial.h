@@ -43,6 +43,14 @@
 
 #include "Timing.h"
 
+/* On Linux the serial port is read and written in blocks through a buffer
+   (see SerialBuffer.h), define TS_UNBUFFERED to read and write a byte at a
+   time with PJON_SERIAL_READ and PJON_SERIAL_WRITE */
+#if defined(LINUX) && !defined(TS_UNBUFFERED)
+  #define TS_BUFFERED
+  #include "SerialBuffer.h"
+#endif
+
 enum TS_state_t : uint8_t {
   TS_WAITING,
   TS_RECEIVING,
@@ -86,10 +94,10 @@ class ThroughSerial {
     /* Check if the channel is free for transmission: */
 
     bool can_start() {
-      PJON_DELAY_MICROSECONDS(PJON_RANDOM(TS_COLLISION_DELAY));
+      PJON_DELAY_MICROSECONDS_PRECISE(PJON_RANDOM(TS_COLLISION_DELAY));
       if(
         (state != TS_WAITING) ||
-        PJON_SERIAL_AVAILABLE(serial) ||
+        serial_available() ||
         ((uint32_t)(PJON_MICROS() - _last_reception_time) < TS_TIME_IN)
       ) return false;
       return true;
@@ -121,14 +129,41 @@ class ThroughSerial {
     /* Handle a collision: */
 
     void handle_collision() {
-      PJON_DELAY_MICROSECONDS(PJON_RANDOM(TS_COLLISION_DELAY));
+      PJON_DELAY_MICROSECONDS_PRECISE(PJON_RANDOM(TS_COLLISION_DELAY));
+    };
+
+
+    /* Serial port access, buffered on Linux: */
+
+    int16_t serial_available() {
+      #ifdef TS_BUFFERED
+        return _input.available(serial);
+      #else
+        return PJON_SERIAL_AVAILABLE(serial);
+      #endif
+    };
+
+    int16_t serial_read() {
+      #ifdef TS_BUFFERED
+        return _input.read_byte(serial);
+      #else
+        return PJON_SERIAL_READ(serial);
+      #endif
+    };
+
+
+    void serial_flush() {
+      PJON_SERIAL_FLUSH(serial);
+      #ifdef TS_BUFFERED
+        _input.clear(); // Discarded as the port's input queue
+      #endif
     };
 
 
     /* Receive Byte */
 
     int16_t receive_byte() {
-      int16_t value = PJON_SERIAL_READ(serial);
+      int16_t value = serial_read();
       if(value == -1) return -1;
       _last_reception_time = PJON_MICROS();
       return value;
@@ -142,8 +177,8 @@ class ThroughSerial {
       uint32_t time = PJON_MICROS();
       uint8_t i = 0;
       while((uint32_t)(PJON_MICROS() - time) < TS_RESPONSE_TIME_OUT) {
-        if(PJON_SERIAL_AVAILABLE(serial)) {
-          int16_t read = PJON_SERIAL_READ(serial);
+        if(serial_available()) {
+          int16_t read = serial_read();
           _last_reception_time = PJON_MICROS();
           if(read >= 0) {
             if(_response[i++] != read) return TS_FAIL;
@@ -179,7 +214,7 @@ class ThroughSerial {
 
       switch(state) {
         case TS_WAITING: {
-          while(PJON_SERIAL_AVAILABLE(serial)) {
+          while(serial_available()) {
             int16_t value = receive_byte();
             if(value == -1) return TS_FAIL;
             if(value == TS_START) {
@@ -190,11 +225,11 @@ class ThroughSerial {
           break;
         }
         case TS_RECEIVING: {
-          while(PJON_SERIAL_AVAILABLE(serial)) {
+          while(serial_available()) {
             int16_t value = receive_byte();
             if((value == TS_START) || (value == -1)) return fail(TS_WAITING);
             if(value == TS_ESC) {
-              if(!PJON_SERIAL_AVAILABLE(serial))
+              if(!serial_available())
                 return fail(TS_WAITING_ESCAPE);
               else {
                 value = receive_byte();
@@ -221,7 +256,7 @@ class ThroughSerial {
         }
 
         case TS_WAITING_ESCAPE: {
-          if(PJON_SERIAL_AVAILABLE(serial)) {
+          if(serial_available()) {
             int16_t value = receive_byte();
             if(value == -1) return fail(TS_WAITING);
             value = value ^ TS_ESC;
@@ -237,7 +272,7 @@ class ThroughSerial {
         }
 
         case TS_WAITING_END: {
-          if(PJON_SERIAL_AVAILABLE(serial)) {
+          if(serial_available()) {
             int16_t value = receive_byte();
             if(value == -1) return fail(TS_WAITING);
             if(value == TS_END) return fail(TS_DONE);
@@ -294,9 +329,18 @@ class ThroughSerial {
       if(response == PJON_ACK) {
         start_tx();
         wait_RS485_pin_change();
-        for(uint8_t i = 0; i < TS_RESPONSE_LENGTH; i++)
-          send_byte(_response[i]);
-        PJON_SERIAL_FLUSH(serial);
+        #ifdef TS_BUFFERED
+          TSSerialBuffer::write(
+            serial,
+            _response,
+            TS_RESPONSE_LENGTH,
+            TS_BYTE_TIME_OUT
+          );
+        #else
+          for(uint8_t i = 0; i < TS_RESPONSE_LENGTH; i++)
+            send_byte(_response[i]);
+        #endif
+        serial_flush();
         wait_RS485_pin_change();
         end_tx();
       }
@@ -309,6 +353,28 @@ class ThroughSerial {
       _fail = false;
       start_tx();
       uint16_t overhead = 2;
+    #ifdef TS_BUFFERED
+      // Encode the whole frame and write it at once
+      uint16_t l = 0;
+      _output[l++] = TS_START;
+      for(uint16_t b = 0; b < length; b++) {
+        // Byte-stuffing
+        if(
+          (data[b] == TS_START) ||
+          (data[b] == TS_ESC) ||
+          (data[b] == TS_END)
+        ) {
+          _output[l++] = TS_ESC;
+          _output[l++] = data[b] ^ TS_ESC;
+          overhead++;
+        } else _output[l++] = data[b];
+      }
+      _output[l++] = TS_END;
+      if(!TSSerialBuffer::write(serial, _output, l, TS_BYTE_TIME_OUT)) {
+        _fail = true;
+        return;
+      }
+    #else
       // Add frame flag
       send_byte(TS_START);
       for(uint16_t b = 0; b < length; b++) {
@@ -325,15 +391,16 @@ class ThroughSerial {
         } else send_byte(data[b]);
       }
       send_byte(TS_END);
+    #endif
       /* On RPI flush fails to wait until all bytes are transmitted
          here RPI forced to wait blocking using delayMicroseconds */
       #if defined(RPI) || defined(LINUX)
         if(_bd)
-          PJON_DELAY_MICROSECONDS(
+          PJON_DELAY_MICROSECONDS_PRECISE(
             ((1000000 / (_bd / 8)) + _flush_offset) * (overhead + length)
           );
       #endif
-      PJON_SERIAL_FLUSH(serial);
+      serial_flush();
       end_tx();
       // Prepare expected response for the receive_response call
       prepare_response(data, length);
@@ -344,6 +411,11 @@ class ThroughSerial {
 
     void set_serial(PJON_SERIAL_TYPE serial_port) {
       serial = serial_port;
+      #ifdef TS_BUFFERED
+        // Reads return at once if no data is available
+        fcntl(serial, F_SETFL, fcntl(serial, F_GETFL) | O_NONBLOCK);
+        _input.clear();
+      #endif
     };
 
 
@@ -368,6 +440,22 @@ class ThroughSerial {
     };
 
   #if defined(RPI) || defined(LINUX)
+    /* File descriptor of the serial port to wait on for incoming frames: */
+
+    int get_fd() const {
+      return serial;
+    };
+
+  #ifdef TS_BUFFERED
+    /* True if bytes already read from the serial port are not consumed or
+       a frame is complete (receive_frame returns it without reading): */
+
+    bool pending() const {
+      return _input.pending() || (state == TS_DONE);
+    };
+  #endif
+
+
     /* Pass baudrate to ThroughSerial
        (needed only for RPI flush hack): */
 
@@ -421,7 +509,11 @@ class ThroughSerial {
   private:
   #if defined(RPI) || defined(LINUX)
     uint16_t _flush_offset = TS_FLUSH_OFFSET;
-    uint32_t _bd;
+    uint32_t _bd = 0;
+  #endif
+  #ifdef TS_BUFFERED
+    TSSerialBuffer _input;
+    uint8_t  _output[(PJON_PACKET_MAX_LENGTH * 2) + 2];
   #endif
     bool     _fail = false;
     uint8_t  _response[TS_RESPONSE_LENGTH];
@@ -61,7 +61,8 @@
   #define TS_READ_INTERVAL       100
 #endif
 
-/* Byte reception timeout (Default 1 second) */
+/* Byte reception timeout, also the longest time a transmission waits
+   to write a byte (Default 1 second) */
 #ifndef TS_BYTE_TIME_OUT
   #define TS_BYTE_TIME_OUT   1000000
 #endif
@@ -0,0 +1,53 @@
+#pragma once
+
+/* PJON_Ack_Queue
+   Ring buffer used by strategies supporting pipelined acknowledgement to
+   keep the acknowledgements received (device id and packet id) until PJON
+   matches them with the packets waiting for them. When full the oldest
+   acknowledgement is overwritten. */
+
+template<uint16_t N>
+struct PJON_Ack_Queue {
+  uint8_t  id[N];
+  uint16_t packet_id[N];
+  uint16_t head = 0;
+  uint16_t count = 0;
+
+  void push(uint8_t device_id, uint16_t packet) {
+    if(count == N) {
+      head = (head + 1) % N;
+      count--;
+    }
+    uint16_t i = (head + count++) % N;
+    id[i] = device_id;
+    packet_id[i] = packet;
+  };
+
+  /* Returns the oldest acknowledgement, false if empty: */
+
+  bool pop(uint8_t &device_id, uint16_t &packet) {
+    if(!count) return false;
+    device_id = id[head];
+    packet = packet_id[head];
+    head = (head + 1) % N;
+    count--;
+    return true;
+  };
+
+  /* Removes a specific acknowledgement, false if not present: */
+
+  bool remove(uint8_t device_id, uint16_t packet) {
+    for(uint16_t c = 0; c < count; c++) {
+      uint16_t i = (head + c) % N;
+      if(id[i] != device_id || packet_id[i] != packet) continue;
+      for(; c < count - 1; c++) {
+        uint16_t next = (head + c + 1) % N;
+        id[(head + c) % N] = id[next];
+        packet_id[(head + c) % N] = packet_id[next];
+      }
+      count--;
+      return true;
+    }
+    return false;
+  };
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+/* Detects if a strategy supports pipelined acknowledgement, it implements:
+
+   bool receive_acknowledge(uint8_t &device_id, uint16_t &packet_id);
+
+   Returns the oldest acknowledgement received and not yet matched, false if
+   there is none.
+
+   uint32_t get_response_timeout();
+
+   Returns the microseconds to wait for an acknowledgement before the packet
+   is retransmitted.
+
+   If the strategy does not implement both, supported is false and PJON
+   delivers every packet waiting for its acknowledgement synchronously. */
+
+#include <utility>
+
+template<typename Strategy, typename = void>
+struct PJON_Pipelined_Ack {
+  static const bool supported = false;
+
+  static bool receive(Strategy &, uint8_t &, uint16_t &) { return false; };
+
+  static uint32_t response_timeout(Strategy &) { return 0; };
+};
+
+template<typename Strategy>
+struct PJON_Pipelined_Ack<
+  Strategy,
+  decltype(
+    (void)std::declval<Strategy &>().receive_acknowledge(
+      std::declval<uint8_t &>(),
+      std::declval<uint16_t &>()
+    ),
+    (void)std::declval<Strategy &>().get_response_timeout()
+  )
+> {
+  static const bool supported = true;
+
+  static bool receive(
+    Strategy &strategy,
+    uint8_t &device_id,
+    uint16_t &packet_id
+  ) {
+    return strategy.receive_acknowledge(device_id, packet_id);
+  };
+
+  static uint32_t response_timeout(Strategy &strategy) {
+    return strategy.get_response_timeout();
+  };
+};
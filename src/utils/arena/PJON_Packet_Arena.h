@@ -0,0 +1,69 @@
+#pragma once
+
+/* PJON_Packet_Arena
+   Fixed memory area from which the content of the packets present in the
+   buffer is allocated, using 4 size classes (32, 128, 512 bytes and
+   PJON_PACKET_MAX_LENGTH). Blocks are carved from the area when first
+   needed and, once released, are kept in a free list of their class.
+   A block is taken from the free list of the required class, else carved
+   from the area, else taken from the free list of a larger class.
+
+   Each block is preceded by a byte containing its class. Free blocks
+   contain the offset of the next free block of the same class. */
+
+#define PJON_ARENA_CLASSES 4
+
+template<uint32_t L>
+struct PJON_Packet_Arena {
+  uint8_t  memory[L];
+  uint32_t used = 0;
+  uint32_t free_list[PJON_ARENA_CLASSES] = {L, L, L, L};
+
+  /* Length of the blocks of a class: */
+
+  static uint16_t class_length(uint8_t c) {
+    static const uint16_t lengths[PJON_ARENA_CLASSES - 1] = {32, 128, 512};
+    if(c < PJON_ARENA_CLASSES - 1 && lengths[c] < PJON_PACKET_MAX_LENGTH)
+      return lengths[c];
+    return PJON_PACKET_MAX_LENGTH;
+  };
+
+  /* Capacity of an allocated block: */
+
+  static uint16_t capacity(const uint8_t *block) {
+    return class_length(block[-1]);
+  };
+
+  /* Returns a block of at least length bytes or NULL if full: */
+
+  uint8_t *allocate(uint16_t length) {
+    uint8_t c = 0;
+    while(c < PJON_ARENA_CLASSES - 1 && class_length(c) < length) c++;
+    if(free_list[c] != L) return pop(c);
+    if((used + class_length(c) + 1) <= L) {
+      memory[used] = c;
+      used += class_length(c) + 1;
+      return memory + used - class_length(c);
+    }
+    for(uint8_t f = c + 1; f < PJON_ARENA_CLASSES; f++)
+      if(free_list[f] != L) return pop(f);
+    return NULL;
+  };
+
+  /* Removes the first block of the free list of a class: */
+
+  uint8_t *pop(uint8_t c) {
+    uint8_t *block = memory + free_list[c];
+    memcpy(&free_list[c], block, sizeof(uint32_t));
+    return block;
+  };
+
+  /* Returns a block to the free list of its class: */
+
+  void release(uint8_t *block) {
+    if(!block) return;
+    uint8_t c = block[-1];
+    memcpy(block, &free_list[c], sizeof(uint32_t));
+    free_list[c] = (uint32_t)(block - memory);
+  };
+};
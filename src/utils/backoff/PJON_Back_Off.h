@@ -0,0 +1,39 @@
+#pragma once
+
+/* Detects if a strategy computes the back off of a receiver, it implements:
+
+   uint32_t back_off(uint8_t attempts, uint8_t receiver_id);
+
+   Returns the microseconds to wait before the next delivery attempt of a
+   packet addressed to receiver_id, for example scaled with the round-trip
+   time measured for that device.
+
+   If the strategy does not implement it, PJON calls back_off(attempts). */
+
+template<typename T> T &PJON_Back_Off_strategy(); // Only in decltype
+
+template<typename Strategy, typename = void>
+struct PJON_Back_Off {
+  static uint32_t compute(Strategy &strategy, uint8_t attempts, uint8_t) {
+    return strategy.back_off(attempts);
+  };
+};
+
+template<typename Strategy>
+struct PJON_Back_Off<
+  Strategy,
+  decltype(
+    (void)PJON_Back_Off_strategy<Strategy>().back_off(
+      (uint8_t)0,
+      (uint8_t)0
+    )
+  )
+> {
+  static uint32_t compute(
+    Strategy &strategy,
+    uint8_t attempts,
+    uint8_t receiver_id
+  ) {
+    return strategy.back_off(attempts, receiver_id);
+  };
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+/* Awaitables returned by PJON::send_async and PJON::receive_async, included
+   if PJON_INCLUDE_COROUTINES is defined (requires C++20).
+
+   The coroutine awaiting a send is resumed by update (or remove) when the
+   packet is delivered (PJON_ACK) or lost (PJON_FAIL), once the call has
+   updated the buffer: it may call update, remove or send again. The
+   coroutine
+   awaiting a reply is resumed by receive when a matching packet is received
+   or by update when the timeout expires. A suspended coroutine costs only
+   its frame, it must not be destroyed while suspended.
+
+   PJON_Task is a coroutine type that starts immediately and frees its frame
+   when it ends:
+
+   PJON_Task request(PJON<DualUDP> &bus) {
+     if(co_await bus.send_async(45, "?", 1) != PJON_ACK) co_return;
+     PJON_Reply reply = co_await bus.receive_async(45, PJON_BROADCAST, 1e6);
+     if(reply.result == PJON_ACK) use(reply.payload, reply.length);
+   }; */
+
+#include <coroutine>
+#include <exception>
+
+#ifndef __cpp_impl_coroutine
+  #error "PJON_INCLUDE_COROUTINES requires C++20 coroutines"
+#endif
+
+struct PJON_Task {
+  struct promise_type {
+    PJON_Task get_return_object() { return PJON_Task(); };
+    std::suspend_never initial_suspend() noexcept { return {}; };
+    std::suspend_never final_suspend() noexcept { return {}; };
+    void return_void() { };
+    void unhandled_exception() { std::terminate(); };
+  };
+};
+
+/* Result of receive_async, payload is valid until the coroutine suspends
+   again (it points in the instance's reception buffer): */
+
+struct PJON_Reply {
+  uint16_t result = PJON_FAIL; // PJON_ACK if received, PJON_FAIL if expired
+  uint8_t *payload = NULL;
+  uint16_t length = 0;
+  PJON_Packet_Info info;
+};
+
+struct PJON_Send_Awaiter {
+  PJON_Send_Awaiter **slot; // NULL if the packet was not dispatched
+  PJON_Send_Awaiter *next = NULL; // Next awaiter to be resumed
+  uint16_t result = PJON_FAIL;
+  std::coroutine_handle<> handle;
+
+  PJON_Send_Awaiter(PJON_Send_Awaiter **s) : slot(s) { };
+
+  bool await_ready() const { return !slot; };
+
+  void await_suspend(std::coroutine_handle<> h) {
+    handle = h;
+    *slot = this;
+  };
+
+  uint16_t await_resume() const { return result; };
+
+  void resume() { handle.resume(); };
+};
+
+struct PJON_Reply_Awaiter {
+  PJON_Reply_Awaiter **slots; // The instance's awaiters
+  uint16_t count;
+  uint8_t  tx_id;             // PJON_NOT_ASSIGNED accepts any sender
+  uint16_t port;              // PJON_BROADCAST accepts any port
+  uint32_t timeout;           // Microseconds, 0 waits indefinitely
+  uint32_t start;
+  PJON_Reply reply;
+  std::coroutine_handle<> handle;
+
+  bool await_ready() const { return false; };
+
+  /* Registers in a free slot, resumes at once with PJON_FAIL if none: */
+
+  bool await_suspend(std::coroutine_handle<> h) {
+    for(uint16_t i = 0; i < count; i++)
+      if(!slots[i]) {
+        handle = h;
+        start = PJON_MICROS();
+        slots[i] = this;
+        return true;
+      }
+    return false;
+  };
+
+  PJON_Reply await_resume() const { return reply; };
+
+  bool matches(const PJON_Packet_Info &info) const {
+    #if(PJON_INCLUDE_PORT)
+      if(port != PJON_BROADCAST && port != info.port) return false;
+    #endif
+    return (tx_id == PJON_NOT_ASSIGNED) || (tx_id == info.tx.id);
+  };
+
+  void complete(
+    uint16_t result,
+    uint8_t *payload = NULL,
+    uint16_t length = 0,
+    const PJON_Packet_Info *info = NULL
+  ) {
+    reply.result = result;
+    reply.payload = payload;
+    reply.length = length;
+    if(info) reply.info = *info;
+    handle.resume();
+  };
+};
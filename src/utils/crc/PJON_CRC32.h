@@ -9,7 +9,83 @@
   (0x82608edb; 0x104c11db7) <=> (0xedb88320; 0x1db710641)
                                     |
                                   bit-reversed polynomial implicit +1 notation
-                                  or reverse reciprocal notation */
+                                  or reverse reciprocal notation
+
+  The implementation used by compute is selected defining PJON_CRC32_MODE:
+  PJON_CRC32_BITWISE - 8 shift/xor per byte, no table (default)
+  PJON_CRC32_TABLE   - 1 lookup per byte, 1KB table
+  PJON_CRC32_SLICE_8 - slicing-by-8, 8 lookups every 8 bytes, 8KB table
+  PJON_CRC32_CLMUL   - x86 PCLMULQDQ folding selected at runtime if the CPU
+                       supports it, otherwise or elsewhere slicing-by-8
+
+  Tables are generated at compile time and are instantiated only if used,
+  on MCUs with little RAM the default table-less implementation is advised. */
+
+#define PJON_CRC32_BITWISE 0
+#define PJON_CRC32_TABLE   1
+#define PJON_CRC32_SLICE_8 2
+#define PJON_CRC32_CLMUL   3
+
+#ifndef PJON_CRC32_MODE
+  #define PJON_CRC32_MODE PJON_CRC32_BITWISE
+#endif
+
+#if(PJON_CRC32_MODE == PJON_CRC32_CLMUL)
+  #include "PJON_CRC32_CLMUL.h"
+#endif
+
+/* Compile-time generation of the lookup tables (C++11 constexpr):
+   row 0 is the classic byte table, row k contains the CRC of the byte
+   followed by k zero bytes, used by the slicing-by-8 implementation. */
+
+template<typename T = void>
+struct PJON_crc32_table {
+  static constexpr uint32_t roll(uint32_t crc, uint8_t bits) {
+    return bits ? roll(
+      (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1), bits - 1
+    ) : crc;
+  };
+
+  static constexpr uint32_t fold(uint32_t crc) {
+    return (crc >> 8) ^ roll(crc & 0xFF, 8);
+  };
+
+  static constexpr uint32_t entry(uint8_t row, uint8_t b) {
+    return row ? fold(entry(row - 1, b)) : roll(b, 8);
+  };
+
+  #define PJON_CRC32_T4(r, n) \
+    entry(r, n), entry(r, n + 1), entry(r, n + 2), entry(r, n + 3)
+  #define PJON_CRC32_T16(r, n) \
+    PJON_CRC32_T4(r, n), PJON_CRC32_T4(r, n + 4), \
+    PJON_CRC32_T4(r, n + 8), PJON_CRC32_T4(r, n + 12)
+  #define PJON_CRC32_T64(r, n) \
+    PJON_CRC32_T16(r, n), PJON_CRC32_T16(r, n + 16), \
+    PJON_CRC32_T16(r, n + 32), PJON_CRC32_T16(r, n + 48)
+  #define PJON_CRC32_T256(r) \
+    { PJON_CRC32_T64(r, 0), PJON_CRC32_T64(r, 64), \
+      PJON_CRC32_T64(r, 128), PJON_CRC32_T64(r, 192) }
+
+  static constexpr uint32_t byte[256] = PJON_CRC32_T256(0);
+
+  static constexpr uint32_t slice[8][256] = {
+    PJON_CRC32_T256(0), PJON_CRC32_T256(1),
+    PJON_CRC32_T256(2), PJON_CRC32_T256(3),
+    PJON_CRC32_T256(4), PJON_CRC32_T256(5),
+    PJON_CRC32_T256(6), PJON_CRC32_T256(7)
+  };
+
+  #undef PJON_CRC32_T4
+  #undef PJON_CRC32_T16
+  #undef PJON_CRC32_T64
+  #undef PJON_CRC32_T256
+};
+
+template<typename T>
+constexpr uint32_t PJON_crc32_table<T>::byte[256];
+
+template<typename T>
+constexpr uint32_t PJON_crc32_table<T>::slice[8][256];
 
 struct PJON_crc32 {
 
@@ -17,6 +93,23 @@ struct PJON_crc32 {
     const uint8_t *data,
     uint16_t length,
     uint32_t previousCrc32 = 0
+  ) {
+    #if(PJON_CRC32_MODE == PJON_CRC32_CLMUL)
+      return compute_clmul(data, length, previousCrc32);
+    #elif(PJON_CRC32_MODE == PJON_CRC32_SLICE_8)
+      return compute_slice_8(data, length, previousCrc32);
+    #elif(PJON_CRC32_MODE == PJON_CRC32_TABLE)
+      return compute_table(data, length, previousCrc32);
+    #else
+      return compute_bitwise(data, length, previousCrc32);
+    #endif
+  };
+
+
+  static inline uint32_t compute_bitwise(
+    const uint8_t *data,
+    uint16_t length,
+    uint32_t previousCrc32 = 0
   ) {
     uint8_t bits;
     uint32_t crc = ~previousCrc32; // same as previousCrc32 ^ 0xFFFFFFFF
@@ -33,6 +126,66 @@ struct PJON_crc32 {
   };
 
 
+  static inline uint32_t compute_table(
+    const uint8_t *data,
+    uint16_t length,
+    uint32_t previousCrc32 = 0
+  ) {
+    const uint32_t *t = PJON_crc32_table<>::byte;
+    uint32_t crc = ~previousCrc32;
+    while(length--) crc = (crc >> 8) ^ t[(crc ^ *data++) & 0xFF];
+    return ~crc;
+  };
+
+
+  static inline uint32_t compute_slice_8(
+    const uint8_t *data,
+    uint16_t length,
+    uint32_t previousCrc32 = 0
+  ) {
+    const uint32_t (*t)[256] = PJON_crc32_table<>::slice;
+    uint32_t crc = ~previousCrc32;
+    while(length >= 8) {
+      // Bytes are assembled explicitly to be endianness independent
+      uint32_t one = crc ^ (
+        (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+        ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24)
+      );
+      uint32_t two =
+        (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+        ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+      crc =
+        t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+        t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+        t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^
+        t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+      data += 8;
+      length -= 8;
+    }
+    while(length--) crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    return ~crc;
+  };
+
+  #if(PJON_CRC32_MODE == PJON_CRC32_CLMUL)
+
+    static inline uint32_t compute_clmul(
+      const uint8_t *data,
+      uint16_t length,
+      uint32_t previousCrc32 = 0
+    ) {
+      #ifdef PJON_CRC32_CLMUL_AVAILABLE
+        if((length >= 64) && PJON_crc32_clmul::supported()) {
+          uint16_t folded = length & ~15;
+          uint32_t crc = ~PJON_crc32_clmul::fold(data, folded, ~previousCrc32);
+          return compute_slice_8(data + folded, length - folded, crc);
+        }
+      #endif
+      return compute_slice_8(data, length, previousCrc32);
+    };
+
+  #endif
+
+
   static inline bool compare(
     const uint32_t computed,
     const uint8_t *received
@@ -0,0 +1,123 @@
+#pragma once
+
+/* CRC32 carry-less multiplication folding for x86 (PCLMULQDQ + SSE4.1)
+   See: Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+   Instruction", and the reflected IEEE constants used by zlib/Chromium.
+
+   The kernel processes a multiple of 16 bytes (at least 64), the remaining
+   bytes are handled by the portable implementation. Availability of the
+   instructions is verified at runtime using cpuid, if not present the
+   portable slicing-by-8 implementation is used. */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define PJON_CRC32_CLMUL_AVAILABLE
+
+  #include <cpuid.h>
+  #include <immintrin.h>
+
+  #define PJON_CRC32_CLMUL_TARGET \
+    __attribute__((target("pclmul,sse4.1")))
+
+struct PJON_crc32_clmul {
+
+  /* Returns true if the CPU supports PCLMULQDQ and SSE4.1: */
+
+  static inline bool supported() {
+    static const int8_t result = detect();
+    return result;
+  };
+
+  static inline int8_t detect() {
+    unsigned int a, b, c, d;
+    if(!__get_cpuid(1, &a, &b, &c, &d)) return 0;
+    return (c & bit_PCLMUL) && (c & bit_SSE4_1);
+  };
+
+  /* Fold length bytes (multiple of 16, at least 64) in the crc register,
+     crc is expected and returned non-inverted: */
+
+  PJON_CRC32_CLMUL_TARGET
+  static uint32_t fold(const uint8_t *data, uint32_t length, uint32_t crc) {
+    alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+    alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+    alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(data + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(data + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(data + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(data + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    x0 = _mm_load_si128((const __m128i *)k1k2);
+    data += 64;
+    length -= 64;
+
+    // Fold 4 x 128 bits in parallel
+    while(length >= 64) {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+      x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+      x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+        _mm_loadu_si128((const __m128i *)(data + 0x00)));
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+        _mm_loadu_si128((const __m128i *)(data + 0x10)));
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+        _mm_loadu_si128((const __m128i *)(data + 0x20)));
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+        _mm_loadu_si128((const __m128i *)(data + 0x30)));
+      data += 64;
+      length -= 64;
+    }
+
+    // Fold 4 x 128 bits into 128 bits
+    x0 = _mm_load_si128((const __m128i *)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Fold remaining 128 bits blocks
+    while(length >= 16) {
+      x2 = _mm_loadu_si128((const __m128i *)data);
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+      data += 16;
+      length -= 16;
+    }
+
+    // Fold 128 bits into 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i *)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+  };
+
+};
+
+  #undef PJON_CRC32_CLMUL_TARGET
+#endif
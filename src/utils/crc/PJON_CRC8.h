@@ -1,4 +1,3 @@
-
 #pragma once
 
 /* Compute CRC8 with a table-less implementation:
@@ -7,25 +6,96 @@
    CRC8 C2, source Baicheva98 (implicit + 1 notation)
    0x97 = (x + 1)(x^7 + x^6 + x^5 + x^2 + 1)^2
    Chosen because it has the largest possible length (119 bit) at which
-   HD=4 can be achieved with 8-bit CRC. */
+   HD=4 can be achieved with 8-bit CRC.
+
+   The implementation is selected defining PJON_CRC8_MODE:
+   PJON_CRC8_BITWISE - 8 shift/xor per byte, no table (default)
+   PJON_CRC8_NIBBLE  - 2 lookups per byte, 16 bytes table
+   PJON_CRC8_TABLE   - 1 lookup per byte, 256 bytes table */
+
+#define PJON_CRC8_BITWISE 0
+#define PJON_CRC8_NIBBLE  1
+#define PJON_CRC8_TABLE   2
+
+#ifndef PJON_CRC8_MODE
+  #define PJON_CRC8_MODE PJON_CRC8_BITWISE
+#endif
+
+/* Compile-time generation of the lookup tables (C++11 constexpr): */
+
+template<typename T = void>
+struct PJON_crc8_table {
+  static constexpr uint8_t roll(uint8_t crc, uint8_t bits) {
+    return bits ? roll(
+      (crc & 1) ? ((crc >> 1) ^ 0x97) : (crc >> 1), bits - 1
+    ) : crc;
+  };
+
+  #define PJON_CRC8_T4(b, n) \
+    roll(n, b), roll(n + 1, b), roll(n + 2, b), roll(n + 3, b)
+  #define PJON_CRC8_T16(b, n) \
+    PJON_CRC8_T4(b, n), PJON_CRC8_T4(b, n + 4), \
+    PJON_CRC8_T4(b, n + 8), PJON_CRC8_T4(b, n + 12)
+  #define PJON_CRC8_T64(b, n) \
+    PJON_CRC8_T16(b, n), PJON_CRC8_T16(b, n + 16), \
+    PJON_CRC8_T16(b, n + 32), PJON_CRC8_T16(b, n + 48)
+
+  static constexpr uint8_t nibble[16] = { PJON_CRC8_T16(4, 0) };
+
+  static constexpr uint8_t byte[256] = {
+    PJON_CRC8_T64(8, 0), PJON_CRC8_T64(8, 64),
+    PJON_CRC8_T64(8, 128), PJON_CRC8_T64(8, 192)
+  };
+
+  #undef PJON_CRC8_T4
+  #undef PJON_CRC8_T16
+  #undef PJON_CRC8_T64
+};
+
+template<typename T>
+constexpr uint8_t PJON_crc8_table<T>::nibble[16];
+
+template<typename T>
+constexpr uint8_t PJON_crc8_table<T>::byte[256];
 
 struct PJON_crc8 {
 
   static inline uint8_t roll(uint8_t input_byte, uint8_t crc) {
-    for(uint8_t i = 8; i; i--, input_byte >>= 1) {
-      uint8_t result = (crc ^ input_byte) & 0x01;
-      crc >>= 1;
-      if(result) crc ^= 0x97;
-    }
+    #if(PJON_CRC8_MODE == PJON_CRC8_TABLE)
+      return PJON_crc8_table<>::byte[crc ^ input_byte];
+    #elif(PJON_CRC8_MODE == PJON_CRC8_NIBBLE)
+      crc ^= input_byte;
+      crc = (crc >> 4) ^ PJON_crc8_table<>::nibble[crc & 0x0F];
+      return (crc >> 4) ^ PJON_crc8_table<>::nibble[crc & 0x0F];
+    #else
+      for(uint8_t i = 8; i; i--, input_byte >>= 1) {
+        uint8_t result = (crc ^ input_byte) & 0x01;
+        crc >>= 1;
+        if(result) crc ^= 0x97;
+      }
+      return crc;
+    #endif
+  };
+
+
+  /* Fold length bytes into a CRC previously computed, it can be used to
+     compute the CRC while bytes are received:
+     uint8_t crc = 0;
+     crc = PJON_crc8::update(crc, header, 3);
+     crc = PJON_crc8::update(crc, payload, length); */
+
+  static inline uint8_t update(
+    uint8_t crc,
+    const uint8_t *input_byte,
+    uint16_t length
+  ) {
+    while(length--) crc = roll(*input_byte++, crc);
     return crc;
   };
 
 
   static inline uint8_t compute(const uint8_t *input_byte, uint16_t length) {
-    uint8_t crc = 0;
-    for(uint16_t b = 0; b < length; b++)
-      crc = roll(input_byte[b], crc);
-    return crc;
+    return update(0, input_byte, length);
   };
 
 };
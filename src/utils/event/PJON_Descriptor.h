@@ -0,0 +1,45 @@
+#pragma once
+
+/* Detects if a strategy implements the optional hooks:
+
+   int get_fd();
+
+   It returns a file descriptor that becomes readable when receive_frame may
+   return a frame, or -1 if there is none at the moment (the strategy must be
+   polled). It is called often and its result can change, for example when a
+   TCP connection is accepted. If the strategy does not implement it -1 is
+   returned.
+
+   bool pending();
+
+   Implemented by strategies buffering what they read from the descriptor,
+   returns true if receive_frame may return a frame without the descriptor
+   becoming readable again. If not implemented false is returned. */
+
+#include <utility>
+
+template<typename Strategy, typename = void>
+struct PJON_Descriptor {
+  static int get(Strategy &) { return -1; };
+};
+
+template<typename Strategy>
+struct PJON_Descriptor<
+  Strategy,
+  decltype((void)std::declval<Strategy &>().get_fd())
+> {
+  static int get(Strategy &strategy) { return strategy.get_fd(); };
+};
+
+template<typename Strategy, typename = void>
+struct PJON_Pending {
+  static bool get(Strategy &) { return false; };
+};
+
+template<typename Strategy>
+struct PJON_Pending<
+  Strategy,
+  decltype((void)std::declval<Strategy &>().pending())
+> {
+  static bool get(Strategy &strategy) { return strategy.pending(); };
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+/* Detects if a strategy implements the optional scatter-gather hook:
+
+   void send_frame_v(const struct iovec *frame, uint8_t count);
+
+   The frame is a list of count segments transmitted as a single frame, the
+   first segment contains the whole header of the packet. If the strategy
+   does not implement it, PJON composes the packet in a contiguous buffer
+   and uses send_frame. */
+
+#include <utility>
+
+template<typename Strategy, typename = void>
+struct PJON_Scatter_Gather {
+  static const bool supported = false;
+
+  static void send_frame_v(Strategy &, const struct iovec *, uint8_t) { };
+};
+
+template<typename Strategy>
+struct PJON_Scatter_Gather<
+  Strategy,
+  decltype((void)std::declval<Strategy &>().send_frame_v(
+    (const struct iovec *)NULL,
+    (uint8_t)0
+  ))
+> {
+  static const bool supported = true;
+
+  static void send_frame_v(
+    Strategy &strategy,
+    const struct iovec *frame,
+    uint8_t count
+  ) {
+    strategy.send_frame_v(frame, count);
+  };
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+/* Header policies select how PJON composes and parses packets, passed as
+   the second template parameter of PJON:
+
+   PJON_Dynamic_Header (default) reads each header bit at runtime.
+
+   PJON_Static_Header<H> fixes the header at compile time. Packets having
+   header H are composed and parsed with constant offsets and no branches
+   on the header bits. The other packets (for example a broadcast if H
+   requests the acknowledgement, or a packet that needs CRC32 or extended
+   length while H does not include it) fall back to the dynamic path.
+   The instance's config is initialized with H.
+
+   PJON<DualUDP, PJON_Static_Header<PJON_TX_INFO_BIT | PJON_CRC_BIT>> bus; */
+
+struct PJON_Dynamic_Header {
+  static const uint8_t config = PJON_TX_INFO_BIT | PJON_ACK_REQ_BIT;
+
+  static uint8_t packet_overhead(uint8_t header) {
+    return PJONTools::packet_overhead(header);
+  };
+
+  static uint16_t compose_packet(
+    const PJON_Packet_Info &info,
+    uint8_t *destination,
+    const void *source,
+    uint16_t length
+  ) {
+    return PJONTools::compose_packet(info, destination, source, length);
+  };
+
+  static uint16_t compose_header(
+    const PJON_Packet_Info &info,
+    uint8_t *destination,
+    uint16_t length
+  ) {
+    return PJONTools::compose_header(info, destination, length);
+  };
+
+  static void parse_header(const uint8_t *packet, PJON_Packet_Info &info) {
+    PJONTools::parse_header(packet, info);
+  };
+};
+
+template<uint8_t H>
+struct PJON_Static_Header {
+  static_assert(
+    (PJON_INCLUDE_PACKET_ID || !(H & PJON_PACKET_ID_BIT)) &&
+    (PJON_INCLUDE_PORT || !(H & PJON_PORT_BIT)) &&
+    (PJON_INCLUDE_MAC || !(H & PJON_MAC_BIT)),
+    "The header includes a feature not included"
+  );
+  static_assert(
+    !(H & PJON_EXT_LEN_BIT) || (H & PJON_CRC_BIT),
+    "Extended length requires CRC32"
+  );
+
+  static const uint8_t config = H;
+  static const uint8_t overhead = PJONTools::packet_overhead(H);
+  static const uint8_t ext = (H & PJON_EXT_LEN_BIT) ? 1 : 0;
+  static const uint8_t tx_info = (H & PJON_TX_INFO_BIT) ? 1 : 0;
+
+  /* Offsets of the fields: */
+  static const uint8_t rx_bus_id_index = 4 + ext;
+  static const uint8_t tx_bus_id_index = rx_bus_id_index + 4;
+  static const uint8_t hops_index = rx_bus_id_index + (tx_info ? 8 : 4);
+  static const uint8_t tx_id_index =
+    (H & PJON_MODE_BIT) ? hops_index + 1 : rx_bus_id_index;
+  static const uint8_t packet_id_index = tx_id_index + tx_info;
+  static const uint8_t port_index =
+    packet_id_index + ((H & PJON_PACKET_ID_BIT) ? 2 : 0);
+  static const uint8_t mac_index =
+    port_index + ((H & PJON_PORT_BIT) ? 2 : 0);
+  static const uint8_t payload_index =
+    mac_index + ((H & PJON_MAC_BIT) ? 12 : 0);
+
+  static_assert(
+    payload_index + PJONTools::crc_overhead(H) == overhead,
+    "Header policy offsets do not match packet_overhead"
+  );
+
+  static uint8_t packet_overhead(uint8_t header) {
+    if(header == H) return overhead;
+    return PJONTools::packet_overhead(header);
+  };
+
+  /* True if the dynamic path would not change the header: */
+
+  static bool matches(const PJON_Packet_Info &info, uint16_t length) {
+    uint16_t new_length = length + overhead;
+    return !(
+      (info.header != H) ||
+      (!(H & PJON_CRC_BIT) && (new_length > 15)) ||
+      (!ext && (new_length > 255)) ||
+      ((H & PJON_ACK_REQ_BIT) && (info.rx.id == PJON_BROADCAST))
+      #if(PJON_INCLUDE_PORT)
+        || (((H & PJON_PORT_BIT) != 0) != (info.port != PJON_BROADCAST))
+      #endif
+    );
+  };
+
+  /* Composes a packet with header H if the dynamic path would not change
+     the header, otherwise uses the dynamic path: */
+
+  static uint16_t compose_packet(
+    const PJON_Packet_Info &info,
+    uint8_t *destination,
+    const void *source,
+    uint16_t length
+  ) {
+    if(!matches(info, length))
+      return PJONTools::compose_packet(info, destination, source, length);
+    uint16_t new_length = write_header(info, destination, length);
+    if(new_length >= PJON_PACKET_MAX_LENGTH) return new_length;
+    memcpy(destination + payload_index, source, length);
+    PJONTools::compose_crc(destination, new_length, H);
+    return new_length;
+  };
+
+  /* Composes the header of a packet having a payload of length bytes: */
+
+  static uint16_t compose_header(
+    const PJON_Packet_Info &info,
+    uint8_t *destination,
+    uint16_t length
+  ) {
+    if(!matches(info, length))
+      return PJONTools::compose_header(info, destination, length);
+    return write_header(info, destination, length);
+  };
+
+  static uint16_t write_header(
+    const PJON_Packet_Info &info,
+    uint8_t *destination,
+    uint16_t length
+  ) {
+    uint16_t new_length = length + overhead;
+    if(new_length >= PJON_PACKET_MAX_LENGTH) return new_length;
+    destination[0] = info.rx.id;
+    destination[1] = H;
+    if(ext) {
+      destination[2] = (uint8_t)(new_length >> 8);
+      destination[3] = (uint8_t)new_length;
+    } else destination[2] = (uint8_t)new_length;
+    destination[3 + ext] = PJON_crc8::compute(destination, 3 + ext);
+    #ifndef PJON_LOCAL
+      if(H & PJON_MODE_BIT) {
+        PJONTools::copy_id(destination + rx_bus_id_index, info.rx.bus_id, 4);
+        if(tx_info)
+          PJONTools::copy_id(destination + tx_bus_id_index, info.tx.bus_id, 4);
+        destination[hops_index] = info.hops;
+      }
+    #endif
+    if(tx_info) destination[tx_id_index] = info.tx.id;
+    #if(PJON_INCLUDE_PACKET_ID)
+      if(H & PJON_PACKET_ID_BIT) {
+        destination[packet_id_index] = (uint8_t)(info.id >> 8);
+        destination[packet_id_index + 1] = (uint8_t)info.id;
+      }
+    #endif
+    #if(PJON_INCLUDE_PORT)
+      if(H & PJON_PORT_BIT) {
+        destination[port_index] = (uint8_t)(info.port >> 8);
+        destination[port_index + 1] = (uint8_t)info.port;
+      }
+    #endif
+    #if(PJON_INCLUDE_MAC)
+      if(H & PJON_MAC_BIT) {
+        PJONTools::copy_id(destination + mac_index, info.rx.mac, 6);
+        PJONTools::copy_id(destination + mac_index + 6, info.tx.mac, 6);
+      }
+    #endif
+    return new_length;
+  };
+
+  /* Parses a packet with header H using constant offsets, otherwise uses
+     the dynamic path: */
+
+  static void parse_header(const uint8_t *packet, PJON_Packet_Info &info) {
+    if(packet[1] != H) {
+      PJONTools::parse_header(packet, info);
+      return;
+    }
+    info = PJON_Packet_Info{};
+    info.rx.id = packet[0];
+    info.header = H;
+    #ifndef PJON_LOCAL
+      if(H & PJON_MODE_BIT) {
+        PJONTools::copy_id(info.rx.bus_id, packet + rx_bus_id_index, 4);
+        if(tx_info)
+          PJONTools::copy_id(info.tx.bus_id, packet + tx_bus_id_index, 4);
+        info.hops = packet[hops_index];
+      }
+    #endif
+    if(tx_info) info.tx.id = packet[tx_id_index];
+    #if(PJON_INCLUDE_PACKET_ID)
+      if(H & PJON_PACKET_ID_BIT)
+        info.id = (packet[packet_id_index] << 8) | packet[packet_id_index + 1];
+    #endif
+    #if(PJON_INCLUDE_PORT)
+      if(H & PJON_PORT_BIT)
+        info.port = (packet[port_index] << 8) | packet[port_index + 1];
+    #endif
+    #if(PJON_INCLUDE_MAC)
+      if(H & PJON_MAC_BIT) {
+        PJONTools::copy_id(info.rx.mac, packet + mac_index, 6);
+        PJONTools::copy_id(info.tx.mac, packet + mac_index + 6, 6);
+      }
+    #endif
+  };
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+/* PJON_Inbox
+   Queue of the frames received by the UDP strategies while waiting for an
+   acknowledgement, kept with the IP address and port of their sender until
+   they are returned by receive_frame. A frame is received directly in the
+   free slot returned by back() and queued with push, when the queue is
+   full back() returns NULL and the frames are dropped. */
+
+template<uint8_t N>
+struct PJON_Inbox {
+  struct Frame {
+    uint8_t  data[PJON_PACKET_MAX_LENGTH];
+    uint16_t length;
+    uint8_t  ip[4];
+    uint16_t port;
+  };
+
+  Frame   frames[N];
+  uint8_t head = 0;
+  uint8_t count = 0;
+
+  Frame *back() {
+    return (count == N) ? NULL : &frames[(head + count) % N];
+  };
+
+  void push(uint16_t length, const uint8_t *ip, uint16_t port) {
+    Frame &frame = frames[(head + count++) % N];
+    frame.length = length;
+    memcpy(frame.ip, ip, 4);
+    frame.port = port;
+  };
+
+  /* Copies the oldest frame in data and its sender in ip and port, returns
+     its length or PJON_FAIL if empty or longer than max_length: */
+
+  uint16_t pop(
+    uint8_t *data,
+    uint16_t max_length,
+    uint8_t *ip,
+    uint16_t &port
+  ) {
+    if(!count) return PJON_FAIL;
+    Frame &frame = frames[head];
+    head = (head + 1) % N;
+    count--;
+    if(frame.length > max_length) return PJON_FAIL;
+    memcpy(data, frame.data, frame.length);
+    memcpy(ip, frame.ip, 4);
+    port = frame.port;
+    return frame.length;
+  };
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+/* PJON_Node_Table
+   Table of the remote nodes (device id, IP address and port number) of the
+   GlobalUDP and DualUDP strategies. It has room for N nodes, of which at
+   most capacity() are used (set at runtime with set_capacity).
+
+   The nodes are stored contiguously, a position is valid until a node is
+   removed (the last node is then moved in its place). An open addressing
+   hash table (linear probing, 2 to 4 buckets per node) maps the device id
+   to the position, so a node is found in constant time independently of
+   the number of nodes registered.
+
+   Nodes added by the user are fixed, the ones registered automatically are
+   kept in a list ordered by the time they were last seen: when the table
+   is full the least recently seen is replaced. The strategies count the
+   failures of each node to remove the unreachable ones.
+
+   The round-trip time of each node is estimated as TCP does (Jacobson and
+   Karels): srtt and rttvar follow the measurements with gains of 1/8 and
+   1/4, the response timeout is srtt + 4 * rttvar. Only frames requesting
+   an acknowledgement are measured, from the first transmission not
+   acknowledged, so an acknowledgement received after retransmissions can
+   only overestimate the round-trip time. Measurements longer than the
+   response timeout of the strategy are discarded, and the estimate is
+   used once PJON_NODE_RTT_SAMPLES measurements are averaged, so a single
+   late acknowledgement can't set it. */
+
+#include <PJONDefines.h>
+
+#define PJON_NODE_NONE 0xFF
+
+// Measurements averaged before the round-trip time is used
+#ifndef PJON_NODE_RTT_SAMPLES
+  #define PJON_NODE_RTT_SAMPLES 4
+#endif
+
+struct PJON_Node {
+  uint8_t  id;
+  uint8_t  ip[4];
+  uint16_t port;
+  uint8_t  failures;  // Failed transmissions since the last response
+  bool     fixed;     // Added by the user, never replaced or removed
+  uint32_t last_seen; // PJON_MILLIS() when last seen
+  uint32_t sent;      // PJON_MICROS() of the first transmission not answered
+  uint32_t srtt;      // Smoothed round-trip time (microseconds, 0 unknown)
+  uint32_t rttvar;    // Round-trip time variation (microseconds)
+  uint8_t  samples;   // Measurements, up to PJON_NODE_RTT_SAMPLES
+  uint8_t  older;     // Least recently seen list (automatic nodes only)
+  uint8_t  newer;
+
+  /* Called when a frame requesting an acknowledgement is transmitted: */
+
+  void transmitted() {
+    if(!failures) sent = PJON_MICROS();
+    if(failures < 0xFF) failures++;
+  };
+
+  /* Called when an acknowledgement is received, a round-trip time longer
+     than max_rtt microseconds is not measured: */
+
+  void acknowledged(uint32_t max_rtt) {
+    uint32_t rtt = (uint32_t)(PJON_MICROS() - sent);
+    if(failures && (rtt <= max_rtt)) measured(rtt);
+    failures = 0;
+  };
+
+  void measured(uint32_t rtt) {
+    if(samples < PJON_NODE_RTT_SAMPLES) {
+      // The first measurements are averaged
+      if(!samples++) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+        return;
+      }
+      int32_t error = (int32_t)rtt - (int32_t)srtt;
+      int32_t deviation = (error < 0) ? -error : error;
+      srtt = (uint32_t)((int32_t)srtt + (error / samples));
+      rttvar =
+        (uint32_t)((int32_t)rttvar + ((deviation - (int32_t)rttvar) / samples));
+      return;
+    }
+    uint32_t error = (rtt > srtt) ? rtt - srtt : srtt - rtt;
+    rttvar = rttvar - (rttvar / 4) + (error / 4);
+    srtt = srtt - (srtt / 8) + (rtt / 8);
+  };
+
+  /* Returns the smoothed round-trip time in microseconds, 0 if unknown: */
+
+  uint32_t rtt() const {
+    return (samples >= PJON_NODE_RTT_SAMPLES) ? srtt : 0;
+  };
+
+  /* Returns the response timeout in microseconds, 0 if unknown: */
+
+  uint32_t timeout() const {
+    return rtt() ? srtt + (4 * rttvar) : 0;
+  };
+};
+
+/* Number of buckets for n nodes, the first power of 2 >= 2n (at least 4): */
+
+constexpr uint16_t PJON_node_buckets(uint16_t n, uint16_t buckets = 4) {
+  return (buckets >= 2 * n) ? buckets : PJON_node_buckets(n, buckets * 2);
+};
+
+template<uint8_t N>
+class PJON_Node_Table {
+  static_assert(N && (N < PJON_NODE_NONE), "A table holds 1 to 254 nodes");
+  static const uint16_t B = PJON_node_buckets(N);
+
+  PJON_Node _nodes[N];
+  uint8_t   _buckets[B] = {}; // Position + 1 of a node, 0 if empty
+  uint8_t   _count = 0;
+  uint8_t   _capacity = N;
+  uint8_t   _oldest = PJON_NODE_NONE;
+  uint8_t   _newest = PJON_NODE_NONE;
+
+  static uint16_t hash(uint8_t id) {
+    return (uint16_t)((id * 40503ul) >> 8) & (B - 1);
+  };
+
+  /* Returns the bucket containing position pos: */
+
+  uint16_t bucket(uint8_t pos) const {
+    uint16_t b = hash(_nodes[pos].id);
+    while(_buckets[b] != pos + 1) b = (b + 1) & (B - 1);
+    return b;
+  };
+
+  /* Empties bucket b moving back the following nodes of its cluster: */
+
+  void erase(uint16_t b) {
+    for(uint16_t next = b;;) {
+      next = (next + 1) & (B - 1);
+      if(!_buckets[next]) break;
+      uint16_t home = hash(_nodes[_buckets[next] - 1].id);
+      // Move back unless its home bucket is between b and next
+      if(((next - home) & (B - 1)) >= ((next - b) & (B - 1))) {
+        _buckets[b] = _buckets[next];
+        b = next;
+      }
+    }
+    _buckets[b] = 0;
+  };
+
+  void link(uint8_t pos) {
+    _nodes[pos].older = _newest;
+    _nodes[pos].newer = PJON_NODE_NONE;
+    if(_newest != PJON_NODE_NONE) _nodes[_newest].newer = pos;
+    else _oldest = pos;
+    _newest = pos;
+  };
+
+  void unlink(uint8_t pos) {
+    PJON_Node &node = _nodes[pos];
+    if(node.older != PJON_NODE_NONE) _nodes[node.older].newer = node.newer;
+    else _oldest = node.newer;
+    if(node.newer != PJON_NODE_NONE) _nodes[node.newer].older = node.older;
+    else _newest = node.older;
+  };
+
+public:
+
+  uint8_t count() const { return _count; };
+
+  uint8_t capacity() const { return _capacity; };
+
+  PJON_Node &operator[](uint8_t pos) { return _nodes[pos]; };
+
+  const PJON_Node &operator[](uint8_t pos) const { return _nodes[pos]; };
+
+  /* Returns the position of the node, -1 if not present: */
+
+  int16_t find(uint8_t id) const {
+    for(uint16_t b = hash(id); _buckets[b]; b = (b + 1) & (B - 1))
+      if(_nodes[_buckets[b] - 1].id == id) return _buckets[b] - 1;
+    return -1;
+  };
+
+  /* Adds a node not present, if the table is full the least recently seen
+     automatic node is replaced. Returns its position, -1 if full: */
+
+  int16_t add(
+    uint8_t id,
+    const uint8_t ip[],
+    uint16_t port,
+    bool fixed
+  ) {
+    if(_count >= _capacity)
+      if((_oldest == PJON_NODE_NONE) || !remove(_oldest)) return -1;
+    uint8_t pos = _count++;
+    PJON_Node &node = _nodes[pos];
+    node.id = id;
+    memcpy(node.ip, ip, 4);
+    node.port = port;
+    node.failures = 0;
+    node.fixed = fixed;
+    node.last_seen = PJON_MILLIS();
+    node.srtt = node.rttvar = 0;
+    node.samples = 0;
+    uint16_t b = hash(id);
+    while(_buckets[b]) b = (b + 1) & (B - 1);
+    _buckets[b] = pos + 1;
+    if(!fixed) link(pos);
+    return pos;
+  };
+
+  /* Records that a node was seen now: */
+
+  void seen(uint8_t pos) {
+    _nodes[pos].last_seen = PJON_MILLIS();
+    if(_nodes[pos].fixed || (_newest == pos)) return;
+    unlink(pos);
+    link(pos);
+  };
+
+  /* Removes an automatic node, false if fixed: */
+
+  bool remove(uint8_t pos) {
+    if(_nodes[pos].fixed) return false;
+    unlink(pos);
+    erase(bucket(pos));
+    uint8_t last = --_count;
+    if(pos == last) return true;
+    // Move the last node in the position left free
+    _buckets[bucket(last)] = pos + 1;
+    PJON_Node &node = _nodes[pos];
+    node = _nodes[last];
+    if(node.fixed) return true;
+    if(node.older != PJON_NODE_NONE) _nodes[node.older].newer = pos;
+    else _oldest = pos;
+    if(node.newer != PJON_NODE_NONE) _nodes[node.newer].older = pos;
+    else _newest = pos;
+    return true;
+  };
+
+  /* Sets the maximum number of nodes (up to N), the least recently seen
+     automatic nodes exceeding it are removed: */
+
+  void set_capacity(uint8_t capacity) {
+    _capacity = (capacity && (capacity < N)) ? capacity : N;
+    while((_count > _capacity) && (_oldest != PJON_NODE_NONE))
+      remove(_oldest);
+  };
+};
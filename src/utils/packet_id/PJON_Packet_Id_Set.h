@@ -0,0 +1,117 @@
+#pragma once
+
+/* PJON_Packet_Id_Set
+   Keeps the last N packet ids received in a ring buffer and indexes them
+   with an open-addressing hash table (linear probing), so both lookup and
+   insertion cost O(1) regardless of N. When the ring buffer is full the
+   oldest record is evicted and removed from the table using backward shift
+   deletion (no tombstones are needed).
+
+   A record matches a packet if packet id and sender id are equal and both
+   are either in local mode or in shared mode with the same sender bus id. */
+
+/* Table length: the lowest power of 2 at least twice n */
+
+constexpr uint32_t PJON_packet_id_table_length(uint32_t n, uint32_t l = 1) {
+  return (l >= 2 * n) ? l : PJON_packet_id_table_length(n, l * 2);
+};
+
+template<uint16_t N>
+struct PJON_Packet_Id_Set {
+  static const uint32_t T = PJON_packet_id_table_length(N);
+
+  PJON_Packet_Record records[N];
+  uint16_t table[T]; // Record index + 1, 0 if empty
+  uint16_t head = 0;
+  uint16_t count = 0;
+
+  PJON_Packet_Id_Set() {
+    memset(table, 0, sizeof(table));
+  };
+
+  static uint32_t hash(
+    uint16_t id,
+    uint8_t sender_id,
+    bool shared,
+    const uint8_t *sender_bus_id
+  ) {
+    uint32_t h = (((uint32_t)id << 8) | sender_id) * 0x9E3779B1;
+    if(shared)
+      for(uint8_t i = 0; i < 4; i++) h = (h ^ sender_bus_id[i]) * 0x01000193;
+    return (h ^ (h >> 16)) & (T - 1);
+  };
+
+  static uint32_t hash(const PJON_Packet_Record &r) {
+    return hash(
+      r.id, r.sender_id, r.header & PJON_MODE_BIT, r.sender_bus_id
+    );
+  };
+
+  static bool match(
+    const PJON_Packet_Record &r,
+    const PJON_Packet_Info &info
+  ) {
+    if(info.id != r.id || info.tx.id != r.sender_id) return false;
+    if((info.header & PJON_MODE_BIT) != (r.header & PJON_MODE_BIT))
+      return false;
+    return !(info.header & PJON_MODE_BIT) ||
+      PJONTools::id_equality(info.tx.bus_id, r.sender_bus_id, 4);
+  };
+
+  bool contains(const PJON_Packet_Info &info) const {
+    uint32_t i = hash(
+      info.id, info.tx.id, info.header & PJON_MODE_BIT, info.tx.bus_id
+    );
+    while(table[i]) {
+      if(match(records[table[i] - 1], info)) return true;
+      i = (i + 1) & (T - 1);
+    }
+    return false;
+  };
+
+  void insert(const PJON_Packet_Info &info) {
+    uint16_t r;
+    if(count < N) r = (head + count++) % N;
+    else { // Evict the oldest record
+      r = head;
+      erase(table_index(r));
+      head = (head + 1) % N;
+    }
+    records[r].id = info.id;
+    records[r].header = info.header;
+    records[r].sender_id = info.tx.id;
+    PJONTools::copy_id(records[r].sender_bus_id, info.tx.bus_id, 4);
+    uint32_t i = hash(records[r]);
+    while(table[i]) i = (i + 1) & (T - 1);
+    table[i] = r + 1;
+  };
+
+  /* Returns the table index pointing to a record, T if not present: */
+
+  uint32_t table_index(uint16_t r) const {
+    uint32_t i = hash(records[r]);
+    while(table[i]) {
+      if(table[i] == r + 1) return i;
+      i = (i + 1) & (T - 1);
+    }
+    return T;
+  };
+
+  /* Backward shift deletion: */
+
+  void erase(uint32_t i) {
+    if(i == T) return;
+    uint32_t j = i;
+    while(true) {
+      j = (j + 1) & (T - 1);
+      if(!table[j]) break;
+      uint32_t k = hash(records[table[j] - 1]);
+      // Move the entry back if its home slot is not in (i, j]
+      if((j > i) ? (k <= i || k > j) : (k <= i && k > j)) {
+        table[i] = table[j];
+        i = j;
+      }
+    }
+    table[i] = 0;
+  };
+};
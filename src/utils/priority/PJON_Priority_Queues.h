@@ -0,0 +1,54 @@
+#pragma once
+
+/* PJON_Priority_Queues
+   Keeps the packets of each priority class in a FIFO queue ordered by
+   dispatch, a repeated packet goes back to the end of its queue after each
+   delivery. Packets are linked by their buffer slot: push and remove cost
+   O(1) and update visits each class in order without scanning the buffer.
+
+   PJON_Receiver_Set marks the receivers having a packet being retried while
+   a queue is visited, so the packets following it are skipped. */
+
+template<uint16_t N, uint8_t C>
+struct PJON_Priority_Queues {
+  uint16_t head[C];
+  uint16_t tail[C];
+  uint16_t next[N];
+  uint16_t previous[N];
+  uint8_t  queue[N]; // Class of the queue containing a slot, C if none
+
+  PJON_Priority_Queues() {
+    for(uint8_t c = 0; c < C; c++) head[c] = tail[c] = PJON_FAIL;
+    for(uint16_t i = 0; i < N; i++) queue[i] = C;
+  };
+
+  /* Appends a slot to the queue of class c (moved if already queued): */
+
+  void push(uint16_t slot, uint8_t c) {
+    remove(slot);
+    queue[slot] = c;
+    previous[slot] = tail[c];
+    next[slot] = PJON_FAIL;
+    if(tail[c] != PJON_FAIL) next[tail[c]] = slot;
+    else head[c] = slot;
+    tail[c] = slot;
+  };
+
+  void remove(uint16_t slot) {
+    uint8_t c = queue[slot];
+    if(c == C) return;
+    if(previous[slot] != PJON_FAIL) next[previous[slot]] = next[slot];
+    else head[c] = next[slot];
+    if(next[slot] != PJON_FAIL) previous[next[slot]] = previous[slot];
+    else tail[c] = previous[slot];
+    queue[slot] = C;
+  };
+};
+
+struct PJON_Receiver_Set {
+  uint8_t bits[32] = {};
+
+  bool has(uint8_t id) const { return bits[id >> 3] & (1 << (id & 7)); };
+
+  void add(uint8_t id) { bits[id >> 3] |= (1 << (id & 7)); };
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+/* PJON_Scheduler
+   Keeps track of the packet buffer's slots: the occupied slots are kept in
+   a binary min-heap ordered by the time of their next delivery attempt, the
+   free slots in a stack. update() visits only the packets that are due,
+   dispatch and remove cost O(log N) instead of a scan of the whole buffer.
+
+   Times are kept on 64 bits extending PJON_MICROS, the extension is correct
+   as long as time is called at least once every 71 minutes. */
+
+template<uint16_t N>
+struct PJON_Scheduler {
+  uint64_t due[N];
+  uint16_t heap[N];
+  uint16_t heap_position[N];
+  uint16_t heap_count = 0;
+  uint16_t free_slots[N];
+  uint16_t free_position[N];
+  uint16_t free_count = N;
+  uint32_t last_time = 0;
+  uint64_t time_high = 0;
+
+  PJON_Scheduler() {
+    for(uint16_t i = 0; i < N; i++) {
+      free_slots[i] = N - 1 - i; // Lower slots are allocated first
+      free_position[N - 1 - i] = i;
+      heap_position[i] = PJON_FAIL;
+    }
+  };
+
+  /* Extend a PJON_MICROS value to 64 bits: */
+
+  uint64_t time(uint32_t now) {
+    if(now < last_time) time_high += (uint64_t)1 << 32;
+    last_time = now;
+    return time_high | now;
+  };
+
+  /* Free slots: */
+
+  uint16_t free_slot() const {
+    return free_count ? free_slots[free_count - 1] : PJON_FAIL;
+  };
+
+  void take(uint16_t slot) {
+    uint16_t position = free_position[slot];
+    if(position == PJON_FAIL) return;
+    uint16_t last = free_slots[--free_count];
+    free_slots[position] = last;
+    free_position[last] = position;
+    free_position[slot] = PJON_FAIL;
+  };
+
+  void release(uint16_t slot) {
+    if(free_position[slot] != PJON_FAIL) return;
+    free_slots[free_count] = slot;
+    free_position[slot] = free_count++;
+  };
+
+  uint16_t occupied() const { return N - free_count; };
+
+  /* Heap of scheduled slots: */
+
+  bool scheduled(uint16_t slot) const {
+    return heap_position[slot] != PJON_FAIL;
+  };
+
+  uint16_t top() const { return heap_count ? heap[0] : PJON_FAIL; };
+
+  void schedule(uint16_t slot, uint64_t time) {
+    unschedule(slot);
+    due[slot] = time;
+    heap[heap_count] = slot;
+    heap_position[slot] = heap_count;
+    sift_up(heap_count++);
+  };
+
+  void unschedule(uint16_t slot) {
+    uint16_t position = heap_position[slot];
+    if(position == PJON_FAIL) return;
+    heap_position[slot] = PJON_FAIL;
+    if(position == --heap_count) return;
+    heap[position] = heap[heap_count];
+    heap_position[heap[position]] = position;
+    sift_down(position);
+    sift_up(position);
+  };
+
+  void swap(uint16_t a, uint16_t b) {
+    uint16_t slot = heap[a];
+    heap[a] = heap[b];
+    heap[b] = slot;
+    heap_position[heap[a]] = a;
+    heap_position[heap[b]] = b;
+  };
+
+  void sift_up(uint16_t position) {
+    while(position) {
+      uint16_t parent = (position - 1) / 2;
+      if(due[heap[parent]] <= due[heap[position]]) return;
+      swap(parent, position);
+      position = parent;
+    }
+  };
+
+  void sift_down(uint16_t position) {
+    while(true) {
+      uint16_t smallest = position;
+      uint16_t left = (2 * position) + 1, right = left + 1;
+      if(left < heap_count && due[heap[left]] < due[heap[smallest]])
+        smallest = left;
+      if(right < heap_count && due[heap[right]] < due[heap[smallest]])
+        smallest = right;
+      if(smallest == position) return;
+      swap(smallest, position);
+      position = smallest;
+    }
+  };
+};
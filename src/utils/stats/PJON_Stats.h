@@ -0,0 +1,42 @@
+#pragma once
+
+/* Statistics collected by a PJON instance if PJON_INCLUDE_STATS is defined.
+   The frames transmitted include retransmissions, the frames received are
+   the ones validated by receive (CRC correct), including the frames then
+   rejected because addressed to another port or MAC address.
+
+   attempts[n] is the number of packets delivered at the attempt n + 1, the
+   last element counts also the packets delivered after more attempts. */
+
+struct PJON_Stats {
+  uint32_t tx_frames = 0;
+  uint32_t tx_bytes = 0;
+  uint32_t tx_busy = 0;        // Transmissions not started (PJON_BUSY)
+  uint32_t rx_frames = 0;
+  uint32_t rx_bytes = 0;
+  uint32_t rx_naks = 0;        // receive returned PJON_NAK
+  uint32_t rx_busy = 0;        // receive returned PJON_BUSY
+  uint32_t crc8_failures = 0;  // Header CRC8 or CRC8 of the whole frame
+  uint32_t crc32_failures = 0;
+  uint32_t collisions = 0;     // Calls to strategy.handle_collision
+  uint32_t lost = 0;           // Packets not delivered
+  uint64_t back_off_time = 0;  // Microseconds
+  uint16_t queue_high_water = 0;
+  uint32_t attempts[PJON_STATS_ATTEMPTS] = {0};
+
+  void transmitted(uint16_t length) {
+    tx_frames++;
+    tx_bytes += length;
+  };
+
+  void received(uint16_t length) {
+    rx_frames++;
+    rx_bytes += length;
+  };
+
+  void delivered(uint8_t attempt) {
+    if(!attempt) attempt = 1;
+    if(attempt > PJON_STATS_ATTEMPTS) attempt = PJON_STATS_ATTEMPTS;
+    attempts[attempt - 1]++;
+  };
+};
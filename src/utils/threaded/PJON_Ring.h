@@ -0,0 +1,131 @@
+#pragma once
+
+/* Bounded lock-free rings of N elements (N must be 2^n) used by
+   PJONThreaded to move packets between threads without locks or dynamic
+   memory. The elements are written and read in place:
+
+   PJON_MPSC_Ring (any number of producers, one consumer) is a bounded
+   queue where each slot has a sequence number: a producer reserves a slot
+   with a compare and swap of the head, fills it and then publishes it
+   storing its sequence, the consumer reads the slot only if published.
+
+   PJON_SPSC_Ring (one producer, one consumer) is a circular buffer where
+   the producer owns the head and the consumer owns the tail.
+
+   Producer:                         Consumer:
+   T *slot = ring.back();            T *slot = ring.front();
+   if(slot) {                        if(slot) {
+     fill(*slot);                      use(*slot);
+     ring.push();                      ring.pop();
+   }                                 }
+
+   PJON_MPSC_Ring::push(f) reserves a slot, calls f(slot) and publishes
+   it, returns false if the ring is full. */
+
+#include <atomic>
+
+#define PJON_CACHE_LINE 64
+
+template<typename T, uint32_t N>
+class PJON_MPSC_Ring {
+  static_assert(N && !(N & (N - 1)), "The length of the ring must be 2^n");
+
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    T value;
+  };
+
+  Slot _slots[N];
+  alignas(PJON_CACHE_LINE) std::atomic<uint32_t> _head;
+  alignas(PJON_CACHE_LINE) uint32_t _tail = 0;
+
+public:
+  PJON_MPSC_Ring() : _head(0) {
+    for(uint32_t i = 0; i < N; i++)
+      _slots[i].sequence.store(i, std::memory_order_relaxed);
+  };
+
+  /* Producers (thread-safe): */
+
+  template<typename Fill>
+  bool push(Fill fill) {
+    uint32_t position = _head.load(std::memory_order_relaxed);
+    for(;;) {
+      Slot &slot = _slots[position & (N - 1)];
+      int32_t difference = (int32_t)(
+        slot.sequence.load(std::memory_order_acquire) - position
+      );
+      if(difference == 0) {
+        if(_head.compare_exchange_weak(
+          position,
+          position + 1,
+          std::memory_order_relaxed
+        )) {
+          fill(slot.value);
+          slot.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if(difference < 0) return false;
+      else position = _head.load(std::memory_order_relaxed);
+    }
+  };
+
+  /* Consumer (a single thread): */
+
+  T *front() {
+    Slot &slot = _slots[_tail & (N - 1)];
+    if(slot.sequence.load(std::memory_order_acquire) != _tail + 1)
+      return NULL;
+    return &slot.value;
+  };
+
+  void pop() {
+    _slots[_tail & (N - 1)].sequence.store(
+      _tail + N,
+      std::memory_order_release
+    );
+    _tail++;
+  };
+};
+
+template<typename T, uint32_t N>
+class PJON_SPSC_Ring {
+  static_assert(N && !(N & (N - 1)), "The length of the ring must be 2^n");
+
+  T _slots[N];
+  alignas(PJON_CACHE_LINE) std::atomic<uint32_t> _head;
+  alignas(PJON_CACHE_LINE) std::atomic<uint32_t> _tail;
+
+public:
+  PJON_SPSC_Ring() : _head(0), _tail(0) { };
+
+  /* Producer: */
+
+  T *back() {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if(head - _tail.load(std::memory_order_acquire) == N) return NULL;
+    return &_slots[head & (N - 1)];
+  };
+
+  void push() {
+    _head.store(
+      _head.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release
+    );
+  };
+
+  /* Consumer: */
+
+  T *front() {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if(_head.load(std::memory_order_acquire) == tail) return NULL;
+    return &_slots[tail & (N - 1)];
+  };
+
+  void pop() {
+    _tail.store(
+      _tail.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release
+    );
+  };
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+/* Tracing of the hot path, included if PJON_INCLUDE_TRACE is defined.
+
+   Each traced span (receive_frame, CRC validation, receiver callback,
+   send_frame, receive_response, back-off and delivery attempts) is stored
+   as a fixed-size record in a ring buffer of PJON_TRACE_LENGTH records
+   shared by all the instances. Writers are lock-free: a slot is reserved
+   with an atomic increment and published with its sequence number, when
+   the ring is full the oldest records are overwritten.
+
+   PJON_Trace<>::dump writes the records in the Chrome trace event format
+   (JSON), it can be opened with chrome://tracing or ui.perfetto.dev. Each
+   instance is a thread named "bus <id>" (see set_trace_id):
+
+   FILE *file = fopen("trace.json", "w");
+   PJON_Trace<>::dump(file);
+   fclose(file); */
+
+#include <atomic>
+#include <stdio.h>
+
+#define PJON_TRACE_RECEIVE_FRAME     0
+#define PJON_TRACE_CRC               1
+#define PJON_TRACE_RECEIVER          2
+#define PJON_TRACE_SEND_FRAME        3
+#define PJON_TRACE_RECEIVE_RESPONSE  4
+#define PJON_TRACE_BACK_OFF          5
+#define PJON_TRACE_ATTEMPT           6
+#define PJON_TRACE_EVENTS            7
+
+#define PJON_TRACE_START(start) uint32_t start = PJON_MICROS()
+
+#define PJON_TRACE_STOP(event, start, length) \
+  PJON_Trace<>::record(event, trace_id(), start, length)
+
+struct PJON_Trace_Record {
+  uint32_t start;    // Microseconds (PJON_MICROS)
+  uint32_t duration; // Microseconds
+  uint16_t length;   // Bytes transmitted or received if applicable
+  uint8_t  event;
+  uint8_t  bus;
+};
+
+template<uint32_t N = PJON_TRACE_LENGTH>
+struct PJON_Trace {
+  static_assert(N && !(N & (N - 1)), "PJON_TRACE_LENGTH must be 2^n");
+
+  static PJON_Trace_Record records[N];
+  static std::atomic<uint32_t> sequence[N];
+  static std::atomic<uint32_t> head;
+
+  static void record(
+    uint8_t event,
+    uint8_t bus,
+    uint32_t start,
+    uint16_t length
+  ) {
+    uint32_t end = PJON_MICROS();
+    uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+    uint32_t slot = index & (N - 1);
+    sequence[slot].store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    records[slot].start = start;
+    records[slot].duration = end - start;
+    records[slot].length = length;
+    records[slot].event = event;
+    records[slot].bus = bus;
+    sequence[slot].store(index + 1, std::memory_order_release);
+  };
+
+  /* Copy up to max records, oldest first, skipping the ones being written.
+     Returns the number of records copied: */
+
+  static uint32_t snapshot(PJON_Trace_Record *destination, uint32_t max) {
+    uint32_t last = head.load(std::memory_order_acquire);
+    uint32_t first = (last > N) ? last - N : 0;
+    if(last - first > max) first = last - max;
+    uint32_t count = 0;
+    for(uint32_t index = first; index < last; index++) {
+      uint32_t slot = index & (N - 1);
+      if(sequence[slot].load(std::memory_order_acquire) != index + 1)
+        continue;
+      PJON_Trace_Record copy = records[slot];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(sequence[slot].load(std::memory_order_relaxed) != index + 1)
+        continue;
+      destination[count++] = copy;
+    }
+    return count;
+  };
+
+  static void clear() {
+    for(uint32_t i = 0; i < N; i++)
+      sequence[i].store(0, std::memory_order_relaxed);
+    head.store(0, std::memory_order_release);
+  };
+
+  static const char *event_name(uint8_t event) {
+    static const char *names[PJON_TRACE_EVENTS] = {
+      "receive_frame", "crc", "receiver", "send_frame",
+      "receive_response", "back_off", "attempt"
+    };
+    return (event < PJON_TRACE_EVENTS) ? names[event] : "unknown";
+  };
+
+  /* Write the records in the Chrome trace event format: */
+
+  static void dump(FILE *file) {
+    static PJON_Trace_Record copy[N];
+    uint32_t count = snapshot(copy, N);
+    bool named[256] = {false};
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for(uint32_t i = 0; i < count; i++) {
+      if(!named[copy[i].bus]) {
+        named[copy[i].bus] = true;
+        fprintf(
+          file,
+          "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+          "\"args\":{\"name\":\"bus %u\"}}",
+          i ? "," : "",
+          copy[i].bus,
+          copy[i].bus
+        );
+      }
+      fprintf(
+        file,
+        ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+        "\"ts\":%lu,\"dur\":%lu,\"args\":{\"length\":%u}}",
+        event_name(copy[i].event),
+        copy[i].bus,
+        (unsigned long)copy[i].start,
+        (unsigned long)copy[i].duration,
+        copy[i].length
+      );
+    }
+    fprintf(file, "\n]}\n");
+  };
+};
+
+template<uint32_t N>
+PJON_Trace_Record PJON_Trace<N>::records[N];
+
+template<uint32_t N>
+std::atomic<uint32_t> PJON_Trace<N>::sequence[N];
+
+template<uint32_t N>
+std::atomic<uint32_t> PJON_Trace<N>::head(0);